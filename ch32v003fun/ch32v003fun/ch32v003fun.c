@@ -1614,6 +1614,40 @@ void SystemInit()
 #endif
 }
 
+void SystemResumeFromStandby( int use_pll )
+{
+#if defined(CH32V003)
+	// Everything but the oscillators and the clock switch survives standby.
+	#if defined(FUNCONF_USE_HSE) && FUNCONF_USE_HSE
+		RCC->CTLR |= RCC_HSEON;
+		while(!(RCC->CTLR&RCC_HSERDY));
+	#endif
+
+	if( use_pll )
+	{
+	#if FUNCONF_SYSTEM_CORE_CLOCK > 25000000
+		FLASH->ACTLR = FLASH_ACTLR_LATENCY_1;               // +1 Cycle Latency
+	#endif
+		RCC->CTLR |= RCC_PLLON;
+		while((RCC->CTLR & RCC_PLLRDY) == 0);                       	// Wait till PLL is ready
+		RCC->CFGR0 = (RCC->CFGR0 & ~(0x03)) | RCC_SW_PLL;       		// Select PLL as system clock source
+		while ((RCC->CFGR0 & (uint32_t)RCC_SWS) != (uint32_t)0x08); 	// Wait till PLL is used as system clock source
+	}
+	else
+	{
+		FLASH->ACTLR = FLASH_ACTLR_LATENCY_0;                   // +0 Cycle Latency, HSI and HSE are both slow enough
+	#if defined(FUNCONF_USE_HSE) && FUNCONF_USE_HSE
+		RCC->CFGR0 = (RCC->CFGR0 & ~(0x03)) | RCC_SW_HSE;
+		while ((RCC->CFGR0 & (uint32_t)RCC_SWS) != (uint32_t)0x04);
+	#endif
+	}
+#else
+	// Other chips lose more than the clocks in standby.
+	(void)use_pll;
+	SystemInit();
+#endif
+}
+
 // C++ Support
 
 #ifdef CPLUSPLUS
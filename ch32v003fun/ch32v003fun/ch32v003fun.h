@@ -19,6 +19,8 @@
 		funDigitalWrite( PA2, FUN_HIGH );
 		funDigitalWrite( PA2, FUN_HIGH );
 
+	   After waking from standby, SystemResumeFromStandby( use_pll );
+
 	4. Delays
 		Delay_Us(n)
 		Delay_Ms(n)
@@ -12887,6 +12889,12 @@ void DelaySysTick( uint32_t n );
 int main() __attribute__((used));
 void SystemInit(void);
 
+// Call after waking from standby (__WFE() with PWR_CTLR_PDDS set) instead of
+// SystemInit(). Standby only stops the oscillators and switches back to HSI, so
+// this just turns them back on. With use_pll = 0 it stays on HSI and skips the
+// PLL lock wait; only do this if you can live with SYSCLK at HSI speed.
+void SystemResumeFromStandby( int use_pll );
+
 #ifdef FUNCONF_UART_PRINTF_BAUD
 	#define UART_BAUD_RATE FUNCONF_UART_PRINTF_BAUD
 #else
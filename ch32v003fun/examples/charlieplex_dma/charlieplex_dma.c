@@ -0,0 +1,42 @@
+// Charlieplexed grayscale LEDs driven by DMA (see extralibs/charlieplex_dma.h).
+//
+// 12 LEDs on PC1-PC4, with a resistor in series with each pin. A brightness
+// wave chases around them. The core only rebuilds the frame every 20 ms; it
+// has nothing to do with the scanning itself.
+
+#include "ch32v003fun.h"
+#include <stdio.h>
+
+#define CHARLIEPLEX_PINS 4
+#define CHARLIEPLEX_DMA_IMPLEMENTATION
+#include "charlieplex_dma.h"
+
+const uint8_t pins[CHARLIEPLEX_PINS] = { 1, 2, 3, 4 };
+uint8_t frame[CHARLIEPLEX_LEDS];
+
+int main()
+{
+	int i, t = 0;
+
+	SystemInit();
+
+	RCC->APB2PCENR |= RCC_APB2Periph_GPIOC;
+
+	CharlieplexDMAInit( GPIOC, pins );
+	CharlieplexDMASetFrame( frame );
+	CharlieplexDMAStart();
+
+	printf( "%d LEDs, %d steps per frame\n", CHARLIEPLEX_LEDS, CHARLIEPLEX_STEPS );
+
+	while(1)
+	{
+		for( i = 0; i < CHARLIEPLEX_LEDS; i++ )
+		{
+			int d = ( i * 256 / CHARLIEPLEX_LEDS - t ) & 0xff;
+			frame[i] = ( d < 128 ) ? ( 127 - d ) * 2 : 0;
+		}
+		CharlieplexDMASetFrame( frame );
+		t += 4;
+		Delay_Ms( 20 );
+	}
+}
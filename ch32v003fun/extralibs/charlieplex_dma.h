@@ -0,0 +1,188 @@
+/* Single-File-Header for driving a grayscale charlieplexed LED matrix with DMA
+   straight to a GPIO port, so the core is free (or asleep) while it plays.
+
+   N pins on one port drive N*(N-1) LEDs. A frame is scanned one "row" (one
+   pin driven high as the anode) at a time, and each row is split into bit
+   planes (binary coded modulation): plane b lasts CHARLIEPLEX_UNIT << b timer
+   counts and lights the LEDs of that row whose brightness has bit b set. So a
+   frame is N * CHARLIEPLEX_BITS steps, and each step is three DMA writes,
+   all paced by TIM2:
+
+	TIM2 update -> DMA1 Channel 2 -> TIM2->ATRLR   (length of the step starting)
+	TIM2 CH3    -> DMA1 Channel 1 -> GPIOx->BSHR   (anode high, cathodes low)
+	TIM2 CH2    -> DMA1 Channel 7 -> GPIOx->CFGLR  (anode + cathodes out, rest floating)
+
+   CH2 and CH3 both match at count 1. BSHR goes first (higher priority), so for
+   a few HCLK cycles the new levels sit on the old directions, which is far
+   shorter than a CHARLIEPLEX_UNIT.
+
+   No interrupts are used. CharlieplexDMASetFrame() rewrites the step buffers in
+   place, so a frame may briefly tear, but there is no glitch worse than that.
+
+   If you are including this in main, simply
+	#define CHARLIEPLEX_DMA_IMPLEMENTATION
+
+   Other defines include:
+	#define CHARLIEPLEX_PINS 4    // Pins used, 2 to 8, all on one port
+	#define CHARLIEPLEX_BITS 8    // Grayscale bits per LED
+	#define CHARLIEPLEX_UNIT 16   // TIM2 counts in the shortest bit plane
+
+   LED n, for anode pin a and cathode pin c (indices into the pins you pass
+   in, a != c), is at n = a * (CHARLIEPLEX_PINS-1) + (c < a ? c : c - 1).
+
+   Call:
+	CharlieplexDMAInit( GPIOC, pins ); // pins[CHARLIEPLEX_PINS], pin numbers 0-7
+	CharlieplexDMASetFrame( brightness ); // CHARLIEPLEX_LEDS values, 0 to (1<<CHARLIEPLEX_BITS)-1
+	CharlieplexDMAStart();
+
+   The pins not in pins[] keep the CFGLR setting they had when Init was called.
+*/
+
+#ifndef _CHARLIEPLEX_DMA_H
+#define _CHARLIEPLEX_DMA_H
+
+#include <stdint.h>
+
+#ifndef CHARLIEPLEX_PINS
+#define CHARLIEPLEX_PINS 4
+#endif
+
+#ifndef CHARLIEPLEX_BITS
+#define CHARLIEPLEX_BITS 8
+#endif
+
+#ifndef CHARLIEPLEX_UNIT
+#define CHARLIEPLEX_UNIT 16
+#endif
+
+#define CHARLIEPLEX_LEDS ((CHARLIEPLEX_PINS)*((CHARLIEPLEX_PINS)-1))
+#define CHARLIEPLEX_STEPS ((CHARLIEPLEX_PINS)*(CHARLIEPLEX_BITS))
+
+void CharlieplexDMAInit( GPIO_TypeDef * port, const uint8_t * pins );
+void CharlieplexDMASetFrame( const uint8_t * brightness );
+void CharlieplexDMAStart( );
+void CharlieplexDMAStop( );
+
+#ifdef CHARLIEPLEX_DMA_IMPLEMENTATION
+
+static GPIO_TypeDef * CharlieplexPort;
+static uint8_t CharlieplexPinList[CHARLIEPLEX_PINS];
+static uint32_t CharlieplexBaseCFGLR;
+
+static uint16_t CharlieplexATRLR[CHARLIEPLEX_STEPS];
+static uint32_t CharlieplexBSHR[CHARLIEPLEX_STEPS];
+static uint32_t CharlieplexCFGLR[CHARLIEPLEX_STEPS];
+
+void CharlieplexDMASetFrame( const uint8_t * brightness )
+{
+	int a, c, b;
+	int step = 0;
+	for( a = 0; a < CHARLIEPLEX_PINS; a++ )
+	{
+		const uint8_t * row = brightness + a * ( CHARLIEPLEX_PINS - 1 );
+		int apin = CharlieplexPinList[a];
+		for( b = 0; b < CHARLIEPLEX_BITS; b++ )
+		{
+			uint32_t bshr = 1 << apin;
+			uint32_t cfglr = CharlieplexBaseCFGLR | ( GPIO_Speed_2MHz | GPIO_CNF_OUT_PP ) << ( 4 * apin );
+			for( c = 0; c < CHARLIEPLEX_PINS; c++ )
+			{
+				int cpin = CharlieplexPinList[c];
+				if( c == a ) continue;
+				if( ( row[( c < a ) ? c : c - 1] >> b ) & 1 )
+				{
+					bshr |= 1 << ( cpin + 16 );
+					cfglr = ( cfglr & ~( 0xf << ( 4 * cpin ) ) ) | ( GPIO_Speed_2MHz | GPIO_CNF_OUT_PP ) << ( 4 * cpin );
+				}
+			}
+			CharlieplexBSHR[step] = bshr;
+			CharlieplexCFGLR[step] = cfglr;
+			// The ATRLR for a step is written by the update at the end of the step before it
+			CharlieplexATRLR[( step + CHARLIEPLEX_STEPS - 1 ) % CHARLIEPLEX_STEPS] = ( CHARLIEPLEX_UNIT << b ) - 1;
+			step++;
+		}
+	}
+}
+
+static void CharlieplexDMAChannel( DMA_Channel_TypeDef * ch, volatile void * reg, void * buf, uint32_t size )
+{
+	ch->CFGR = 0;
+	ch->PADDR = (uint32_t)reg;
+	ch->MADDR = (uint32_t)buf;
+	ch->CNTR = CHARLIEPLEX_STEPS;
+	ch->CFGR =
+		DMA_M2M_Disable |
+		DMA_Priority_VeryHigh |
+		size |
+		DMA_MemoryInc_Enable |
+		DMA_Mode_Circular |
+		DMA_DIR_PeripheralDST;
+}
+
+void CharlieplexDMAInit( GPIO_TypeDef * port, const uint8_t * pins )
+{
+	int p;
+	RCC->AHBPCENR |= RCC_AHBPeriph_DMA1;
+	RCC->APB1PCENR |= RCC_APB1Periph_TIM2;
+
+	CharlieplexPort = port;
+	CharlieplexBaseCFGLR = port->CFGLR;
+	for( p = 0; p < CHARLIEPLEX_PINS; p++ )
+	{
+		CharlieplexPinList[p] = pins[p];
+		CharlieplexBaseCFGLR &= ~( 0xf << ( 4 * pins[p] ) );
+		CharlieplexBaseCFGLR |= GPIO_CNF_IN_FLOATING << ( 4 * pins[p] );
+	}
+	port->CFGLR = CharlieplexBaseCFGLR;
+
+	// Reset TIM2 to init all regs
+	RCC->APB1PRSTR |= RCC_APB1Periph_TIM2;
+	RCC->APB1PRSTR &= ~RCC_APB1Periph_TIM2;
+
+	// CH2 and CH3 are frozen compares, only used for their DMA requests
+	TIM2->PSC = 0;
+	TIM2->CH2CVR = 1;
+	TIM2->CH3CVR = 1;
+	// No ARPE, so the ATRLR written at each update applies to the step just starting
+	TIM2->CTLR1 = 0;
+
+	// All-dark frame until the first SetFrame
+	for( p = 0; p < CHARLIEPLEX_STEPS; p++ )
+	{
+		CharlieplexATRLR[p] = CHARLIEPLEX_UNIT - 1;
+		CharlieplexBSHR[p] = 0;
+		CharlieplexCFGLR[p] = CharlieplexBaseCFGLR;
+	}
+}
+
+void CharlieplexDMAStart( )
+{
+	CharlieplexDMAChannel( DMA1_Channel2, &TIM2->ATRLR, CharlieplexATRLR, DMA_MemoryDataSize_HalfWord | DMA_PeripheralDataSize_HalfWord );
+	CharlieplexDMAChannel( DMA1_Channel1, &CharlieplexPort->BSHR, CharlieplexBSHR, DMA_MemoryDataSize_Word | DMA_PeripheralDataSize_Word );
+	CharlieplexDMAChannel( DMA1_Channel7, &CharlieplexPort->CFGLR, CharlieplexCFGLR, DMA_MemoryDataSize_Word | DMA_PeripheralDataSize_Word );
+	DMA1_Channel2->CFGR |= DMA_CFGR1_EN;
+	DMA1_Channel1->CFGR |= DMA_CFGR1_EN;
+	DMA1_Channel7->CFGR |= DMA_CFGR1_EN;
+
+	// The last entry is step 0's length, after that the DMA takes over
+	TIM2->ATRLR = CharlieplexATRLR[CHARLIEPLEX_STEPS - 1];
+	TIM2->CNT = 0;
+	TIM2->SWEVGR = TIM_UG;
+	TIM2->DMAINTENR = TIM_UDE | TIM_CC2DE | TIM_CC3DE;
+	TIM2->CTLR1 |= TIM_CEN;
+}
+
+void CharlieplexDMAStop( )
+{
+	TIM2->CTLR1 &= ~TIM_CEN;
+	TIM2->DMAINTENR = 0;
+	DMA1_Channel1->CFGR &= ~DMA_CFGR1_EN;
+	DMA1_Channel2->CFGR &= ~DMA_CFGR1_EN;
+	DMA1_Channel7->CFGR &= ~DMA_CFGR1_EN;
+	CharlieplexPort->CFGLR = CharlieplexBaseCFGLR;
+}
+
+#endif
+
+#endif
+
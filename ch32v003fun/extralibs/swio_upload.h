@@ -0,0 +1,186 @@
+/* Single-File-Header for receiving a file over the debug link while your
+   program runs, from minichlink -S. No reflash, no reset.
+
+   It rides on the same DMDATA0/1 channel as printf and minichlink -T, so it
+   needs FUNCONF_USE_DEBUGPRINTF (the default). The terminal sends at most 3
+   bytes at a time. Upload frames are always 7 bytes (DMDATA0 bits 8..31 and
+   all of DMDATA1), which is how they are told apart:
+
+	0xA0 region len0 len1 len2 0 0      Start, len is little endian
+	seq d0 d1 d2 d3 d4 d5               Data, seq counts 0 to 0x7f and wraps
+	0xA1 crc0 crc1 crc2 crc3 0 0        End, CRC-32 (zlib) of the whole file
+	0xA2 0 0 0 0 0 0                    Abort
+
+   The host sends one frame, waits for poll_input() to take it (DMDATA0 goes
+   to 0), then sends the next. Once a start is seen, SWIOUploadRun() sits in a
+   loop calling poll_input(), so a transfer goes as fast as the programmer can
+   go. At the end it printf()s one line, "UPLOAD OK" or "UPLOAD ERR <why>",
+   which minichlink waits for.
+
+   If you are including this in main, simply
+	#define SWIO_UPLOAD_IMPLEMENTATION
+
+   Other defines include:
+	#define SWIO_UPLOAD_TIMEOUT_MS 1000  // Give up after this long with no frame
+
+   You will need to implement the following callbacks. Any nonzero return
+   aborts the upload with that code.
+	int SWIOUploadBegin( uint8_t region, uint32_t length );
+	int SWIOUploadData( uint32_t offset, const uint8_t * data, int len );
+	int SWIOUploadEnd( int ok ); // ok if all of it arrived, CRC matching. Always
+	                             // called once Begin has returned 0
+
+   And call, from your handle_debug_input( numbytes, data ),
+	if( SWIOUploadHandleInput( numbytes, data ) ) return;
+   and, from your main loop, after poll_input(),
+	SWIOUploadRun();
+*/
+
+#ifndef _SWIO_UPLOAD_H
+#define _SWIO_UPLOAD_H
+
+#include <stdint.h>
+
+#define SWIO_UPLOAD_FRAME 7
+#define SWIO_UPLOAD_START 0xA0
+#define SWIO_UPLOAD_END   0xA1
+#define SWIO_UPLOAD_ABORT 0xA2
+
+// Error codes, as printed after "UPLOAD ERR"
+#define SWIO_UPLOAD_ERR_SEQUENCE 1 // A data frame was lost or repeated
+#define SWIO_UPLOAD_ERR_LENGTH   2 // More or less data than the start said
+#define SWIO_UPLOAD_ERR_CRC      3
+#define SWIO_UPLOAD_ERR_TIMEOUT  4
+#define SWIO_UPLOAD_ERR_ABORTED  5
+
+#ifndef SWIO_UPLOAD_TIMEOUT_MS
+#define SWIO_UPLOAD_TIMEOUT_MS 1000
+#endif
+
+int SWIOUploadHandleInput( int numbytes, uint8_t * data );
+void SWIOUploadRun( );
+
+// Callbacks that you must implement.
+int SWIOUploadBegin( uint8_t region, uint32_t length );
+int SWIOUploadData( uint32_t offset, const uint8_t * data, int len );
+int SWIOUploadEnd( int ok );
+
+#ifdef SWIO_UPLOAD_IMPLEMENTATION
+
+#include <stdio.h>
+
+static uint8_t SWIOUploadActive;
+static uint8_t SWIOUploadSeq;
+static uint8_t SWIOUploadGotFrame;
+static int SWIOUploadError;
+static uint32_t SWIOUploadLength;
+static uint32_t SWIOUploadOffset;
+static uint32_t SWIOUploadCRC;
+
+// Bitwise CRC-32, slow but tiny, and it only has to keep up with SWIO
+static uint32_t SWIOUploadCRCByte( uint32_t crc, uint8_t b )
+{
+	int i;
+	crc ^= b;
+	for( i = 0; i < 8; i++ )
+		crc = ( crc >> 1 ) ^ ( 0xEDB88320 & -( crc & 1 ) );
+	return crc;
+}
+
+static void SWIOUploadFinish( int err )
+{
+	int r;
+	if( !SWIOUploadActive ) return;
+	SWIOUploadActive = 0;
+	r = SWIOUploadEnd( err == 0 );
+	SWIOUploadError = err ? err : r;
+}
+
+int SWIOUploadHandleInput( int numbytes, uint8_t * data )
+{
+	uint8_t cmd = data[0];
+	if( numbytes != SWIO_UPLOAD_FRAME ) return 0;
+	SWIOUploadGotFrame = 1;
+
+	if( cmd == SWIO_UPLOAD_START )
+	{
+		int err;
+		SWIOUploadFinish( SWIO_UPLOAD_ERR_ABORTED );
+		SWIOUploadLength = data[2] | ( data[3] << 8 ) | ( (uint32_t)data[4] << 16 );
+		SWIOUploadOffset = 0;
+		SWIOUploadSeq = 0;
+		SWIOUploadCRC = 0xffffffff;
+		SWIOUploadError = 0;
+		err = SWIOUploadBegin( data[1], SWIOUploadLength );
+		if( err )
+			SWIOUploadError = err;
+		else
+			SWIOUploadActive = 1;
+		return 1;
+	}
+	if( !SWIOUploadActive ) return 1;
+
+	if( cmd == SWIO_UPLOAD_END )
+	{
+		uint32_t crc = data[1] | ( data[2] << 8 ) | ( data[3] << 16 ) | ( (uint32_t)data[4] << 24 );
+		if( SWIOUploadOffset != SWIOUploadLength )
+			SWIOUploadFinish( SWIO_UPLOAD_ERR_LENGTH );
+		else if( ~SWIOUploadCRC != crc )
+			SWIOUploadFinish( SWIO_UPLOAD_ERR_CRC );
+		else
+			SWIOUploadFinish( 0 );
+	}
+	else if( cmd == SWIO_UPLOAD_ABORT )
+	{
+		SWIOUploadFinish( SWIO_UPLOAD_ERR_ABORTED );
+	}
+	else if( cmd != SWIOUploadSeq )
+	{
+		SWIOUploadFinish( SWIO_UPLOAD_ERR_SEQUENCE );
+	}
+	else
+	{
+		int len = SWIOUploadLength - SWIOUploadOffset;
+		int i, err;
+		if( len > SWIO_UPLOAD_FRAME - 1 ) len = SWIO_UPLOAD_FRAME - 1;
+		if( len <= 0 )
+		{
+			SWIOUploadFinish( SWIO_UPLOAD_ERR_LENGTH );
+			return 1;
+		}
+		for( i = 0; i < len; i++ )
+			SWIOUploadCRC = SWIOUploadCRCByte( SWIOUploadCRC, data[i + 1] );
+		err = SWIOUploadData( SWIOUploadOffset, data + 1, len );
+		SWIOUploadOffset += len;
+		SWIOUploadSeq = ( SWIOUploadSeq + 1 ) & 0x7f;
+		if( err ) SWIOUploadFinish( err );
+	}
+	return 1;
+}
+
+void SWIOUploadRun( )
+{
+	uint32_t last;
+	if( !SWIOUploadActive && !SWIOUploadError ) return;
+
+	last = SysTick->CNT;
+	while( SWIOUploadActive )
+	{
+		SWIOUploadGotFrame = 0;
+		poll_input();
+		if( SWIOUploadGotFrame )
+			last = SysTick->CNT;
+		else if( SysTick->CNT - last > SWIO_UPLOAD_TIMEOUT_MS * DELAY_MS_TIME )
+			SWIOUploadFinish( SWIO_UPLOAD_ERR_TIMEOUT );
+	}
+
+	if( SWIOUploadError )
+		printf( "UPLOAD ERR %d\n", SWIOUploadError );
+	else
+		printf( "UPLOAD OK\n" );
+	SWIOUploadError = 0;
+}
+
+#endif
+
+#endif
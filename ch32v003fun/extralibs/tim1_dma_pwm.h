@@ -0,0 +1,139 @@
+/* Single-File-Header for playing back PWM frames on TIM1 using DMA, so the core
+   does not need to wake up and write the compare registers for every period.
+
+   Every TIM1 update (one PWM period, one "frame") the timer asks DMA1 Channel 5
+   for a burst of four halfwords, which land in CH1CVR..CH4CVR. The frames come
+   from a circular buffer in RAM. When half of the buffer has been played, the
+   DMA interrupt calls back to fill that half in again while the other half
+   plays, so the core can sit in __WFI() (sleep, not standby: TIM1 and DMA need
+   their clocks) for TIM1DMAPWM_FRAMES/2 frames at a time.
+
+   If you are including this in main, simply
+	#define TIM1DMAPWM_IMPLEMENTATION
+
+   Other defines include:
+	#define TIM1DMAPWM_FRAMES 16  // Frames in the buffer. Must be even.
+
+   You will need to implement the following function, as a callback from the ISR.
+	void TIM1DMAPWMFrameCallback( uint16_t * cvr );
+   It fills in cvr[0..3], the values of CH1CVR..CH4CVR for one frame.
+
+   Set TIM1 up as usual (clock, pins, PSC, ATRLR for the frame length, channel
+   modes, CCER, BDTR) but leave it stopped and not in one-pulse mode, then call
+	TIM1DMAPWMInit();
+	TIM1DMAPWMStart();
+
+   Init turns on compare preload (OCxPE), so each frame's values take effect at
+   the start of the frame after the burst that wrote them.
+*/
+
+#ifndef _TIM1_DMA_PWM_H
+#define _TIM1_DMA_PWM_H
+
+#include <stdint.h>
+
+#ifndef TIM1DMAPWM_FRAMES
+#define TIM1DMAPWM_FRAMES 16
+#endif
+
+// Compare values per frame, CH1CVR..CH4CVR
+#define TIM1DMAPWM_CHANNELS 4
+
+void TIM1DMAPWMInit( );
+void TIM1DMAPWMStart( );
+void TIM1DMAPWMStop( );
+
+// Callback that you must implement.
+void TIM1DMAPWMFrameCallback( uint16_t * cvr );
+
+#ifdef TIM1DMAPWM_IMPLEMENTATION
+
+#define TIM1DMAPWM_BUFFER_LEN ((TIM1DMAPWM_FRAMES)*TIM1DMAPWM_CHANNELS)
+
+static uint16_t TIM1DMAPWMbuff[TIM1DMAPWM_BUFFER_LEN];
+
+static void TIM1DMAPWMFillFrames( uint16_t * ptr, int frames )
+{
+	while( frames-- )
+	{
+		TIM1DMAPWMFrameCallback( ptr );
+		ptr += TIM1DMAPWM_CHANNELS;
+	}
+}
+
+void DMA1_Channel5_IRQHandler( void ) __attribute__((interrupt));
+void DMA1_Channel5_IRQHandler( void )
+{
+	volatile int intfr = DMA1->INTFR;
+	do
+	{
+		DMA1->INTFCR = DMA1_IT_GL5;
+
+		if( intfr & DMA1_IT_HT5 )
+		{
+			// First half has been sent, refill it
+			TIM1DMAPWMFillFrames( TIM1DMAPWMbuff, TIM1DMAPWM_FRAMES / 2 );
+		}
+		if( intfr & DMA1_IT_TC5 )
+		{
+			// Second half has been sent, refill it
+			TIM1DMAPWMFillFrames( TIM1DMAPWMbuff + TIM1DMAPWM_BUFFER_LEN / 2, TIM1DMAPWM_FRAMES / 2 );
+		}
+		intfr = DMA1->INTFR & ( DMA1_IT_HT5 | DMA1_IT_TC5 );
+	} while( intfr );
+}
+
+void TIM1DMAPWMStart( )
+{
+	TIM1DMAPWMFillFrames( TIM1DMAPWMbuff, TIM1DMAPWM_FRAMES );
+
+	DMA1_Channel5->CFGR &= ~DMA_CFGR1_EN;
+	DMA1_Channel5->MADDR = (uint32_t)TIM1DMAPWMbuff;
+	DMA1_Channel5->CNTR = TIM1DMAPWM_BUFFER_LEN;
+	DMA1_Channel5->CFGR |= DMA_CFGR1_EN;
+
+	TIM1->CNT = 0;
+	TIM1->SWEVGR = TIM_UG;                   // Load PSC/ATRLR before the DMA is hooked up
+	TIM1->DMAINTENR |= TIM_UDE;
+	TIM1->CTLR1 |= TIM_ARPE | TIM_CEN;
+}
+
+void TIM1DMAPWMStop( )
+{
+	TIM1->CTLR1 &= ~TIM_CEN;
+	TIM1->DMAINTENR &= ~TIM_UDE;
+	DMA1_Channel5->CFGR &= ~DMA_CFGR1_EN;
+}
+
+void TIM1DMAPWMInit( )
+{
+	RCC->AHBPCENR |= RCC_AHBPeriph_DMA1;
+
+	// Compare values only change at an update
+	TIM1->CHCTLR1 |= TIM_OC1PE | TIM_OC2PE;
+	TIM1->CHCTLR2 |= TIM_OC3PE | TIM_OC4PE;
+
+	// Each update sends a burst of 4 halfwords, starting at CH1CVR
+	TIM1->DMACFGR = TIM_DMABase_CCR1 | TIM_DMABurstLength_4Transfers;
+
+	// DMA1_Channel5 is for TIM1_UP
+	DMA1_Channel5->PADDR = (uint32_t)&TIM1->DMAADR;
+	DMA1_Channel5->MADDR = (uint32_t)TIM1DMAPWMbuff;
+	DMA1_Channel5->CNTR  = 0;
+	DMA1_Channel5->CFGR  =
+		DMA_M2M_Disable |
+		DMA_Priority_VeryHigh |
+		DMA_MemoryDataSize_HalfWord |
+		DMA_PeripheralDataSize_HalfWord |
+		DMA_MemoryInc_Enable |
+		DMA_Mode_Circular |
+		DMA_DIR_PeripheralDST |
+		DMA_IT_TC | DMA_IT_HT; // Transmission Complete + Half Empty Interrupts.
+
+	NVIC_EnableIRQ( DMA1_Channel5_IRQn );
+}
+
+#endif
+
+#endif
+
@@ -0,0 +1,205 @@
+// Batch mode (-M), for flashing a run of boards. Every attached WCH-LinkE,
+// ESP32S2 programmer and B003Fun bootloader is opened, then each one gets its
+// own thread to unbrick, erase, write and verify its board. A batch takes as
+// long as the slowest board, however many programmers there are.
+//
+// All of the programmers are opened up front, from this thread. MCF is thread
+// local, so each board keeps a copy of the one its driver filled in, and its
+// thread takes that copy as its own.
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "minichlink.h"
+
+#if defined( MINICHLINK_NO_THREADS )
+#elif defined(WINDOWS) || defined(WIN32) || defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#define MAX_BATCH_BOARDS 64
+
+struct BatchProgrammer
+{
+	const char * name; // As for -C
+	void * (*init)( const init_hints_t * );
+};
+
+static const struct BatchProgrammer batch_programmers[] = {
+	{ "linke", TryInit_WCHLinkE },
+	{ "esp32s2chfun", TryInit_ESP32S2CHFUN },
+	{ "b003boot", TryInit_B003Fun },
+};
+
+struct BatchBoard
+{
+	struct MiniChlinkFunctions mcf;
+	void * dev;
+	const char * programmer;
+	int index;
+	const char * failed; // The step that failed, 0 if it passed
+#if defined( MINICHLINK_NO_THREADS )
+#elif defined(WINDOWS) || defined(WIN32) || defined(_WIN32)
+	HANDLE thread;
+#else
+	pthread_t thread;
+#endif
+};
+
+static struct BatchBoard batch_boards[MAX_BATCH_BOARDS];
+static uint8_t * batch_image;
+static int batch_len;
+static uint32_t batch_offset;
+
+static const char * BatchFlashSteps( void * dev )
+{
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	int is_flash = IsAddressFlash( batch_offset );
+
+	if( batch_len > iss->flash_size ) return "too large";
+
+	// Power cycling needs control of the target's supply. The B003Fun
+	// bootloader runs on the target, so it can't.
+	if( MCF.Control3v3 && MCF.Unbrick )
+	{
+		if( MCF.Unbrick( dev ) ) return "unbrick";
+	}
+	if( MCF.SetupInterface && MCF.SetupInterface( dev ) < 0 ) return "setup";
+	PostSetupConfigureInterface( dev );
+
+	if( is_flash )
+	{
+		if( MCF.HaltMode ) MCF.HaltMode( dev, HALT_MODE_HALT_AND_RESET );
+		if( !MCF.Erase || MCF.Erase( dev, 0, 0, 1 ) ) return "erase";
+	}
+	else if( MCF.HaltMode )
+		MCF.HaltMode( dev, HALT_MODE_HALT_BUT_NO_RESET );
+
+	if( !MCF.WriteBinaryBlob || MCF.WriteBinaryBlob( dev, batch_offset, batch_len, batch_image ) ) return "write";
+
+	if( VerifyBinaryBlob( dev, batch_offset, batch_len, batch_image ) ) return "verify";
+
+	if( is_flash && MCF.HaltMode ) MCF.HaltMode( dev, HALT_MODE_REBOOT );
+	return 0;
+}
+
+static void * BatchFlashBoard( void * v )
+{
+	struct BatchBoard * b = (struct BatchBoard *)v;
+	MCF = b->mcf;
+	b->failed = BatchFlashSteps( b->dev );
+	if( MCF.FlushLLCommands ) MCF.FlushLLCommands( b->dev );
+	if( MCF.Exit ) MCF.Exit( b->dev );
+	return 0;
+}
+
+#if !defined( MINICHLINK_NO_THREADS ) && ( defined(WINDOWS) || defined(WIN32) || defined(_WIN32) )
+static DWORD WINAPI BatchFlashBoardThread( LPVOID v )
+{
+	BatchFlashBoard( v );
+	return 0;
+}
+#endif
+
+static int BatchOpenAll( const init_hints_t * hints )
+{
+	int count = 0;
+	int p;
+	for( p = 0; p < sizeof( batch_programmers ) / sizeof( batch_programmers[0] ); p++ )
+	{
+		const struct BatchProgrammer * bp = &batch_programmers[p];
+		init_hints_t h = *hints;
+		if( hints->specific_programmer && strcmp( hints->specific_programmer, bp->name ) ) continue;
+
+		for( h.programmer_index = 0; count < MAX_BATCH_BOARDS; h.programmer_index++ )
+		{
+			struct BatchBoard * b = &batch_boards[count];
+			void * dev;
+
+			// The drivers only fill in what they have
+			memset( &MCF, 0, sizeof( MCF ) );
+			dev = bp->init( &h );
+			if( !dev ) break;
+			SetupInternalState( dev );
+			SetupAutomaticHighLevelFunctions( dev );
+
+			b->mcf = MCF;
+			b->dev = dev;
+			b->programmer = bp->name;
+			b->index = h.programmer_index;
+			count++;
+		}
+	}
+	return count;
+}
+
+int BatchFlash( const init_hints_t * hints, const char * fname, uint32_t offset )
+{
+	int count, i, failed = 0;
+	FILE * f = fopen( fname, "rb" );
+	if( !f )
+	{
+		fprintf( stderr, "Error: Could not open %s\n", fname );
+		return -55;
+	}
+	fseek( f, 0, SEEK_END );
+	batch_len = ftell( f );
+	fseek( f, 0, SEEK_SET );
+	batch_image = malloc( batch_len + 1 );
+	if( batch_len && fread( batch_image, batch_len, 1, f ) != 1 )
+	{
+		fprintf( stderr, "Error: File I/O Fault.\n" );
+		fclose( f );
+		return -10;
+	}
+	fclose( f );
+	batch_offset = offset;
+
+	count = BatchOpenAll( hints );
+	if( !count )
+	{
+		fprintf( stderr, "Error: Could not initialize any supported programmers\n" );
+		return -32;
+	}
+	fprintf( stderr, "Flashing %d board%s\n", count, ( count == 1 ) ? "" : "s" );
+
+	for( i = 0; i < count; i++ )
+	{
+#if defined( MINICHLINK_NO_THREADS )
+		BatchFlashBoard( &batch_boards[i] );
+#elif defined(WINDOWS) || defined(WIN32) || defined(_WIN32)
+		batch_boards[i].thread = CreateThread( 0, 0, BatchFlashBoardThread, &batch_boards[i], 0, 0 );
+#else
+		pthread_create( &batch_boards[i].thread, 0, BatchFlashBoard, &batch_boards[i] );
+#endif
+	}
+	for( i = 0; i < count; i++ )
+	{
+#if defined( MINICHLINK_NO_THREADS )
+#elif defined(WINDOWS) || defined(WIN32) || defined(_WIN32)
+		WaitForSingleObject( batch_boards[i].thread, INFINITE );
+		CloseHandle( batch_boards[i].thread );
+#else
+		pthread_join( batch_boards[i].thread, 0 );
+#endif
+	}
+
+	printf( "\n%-6s %-14s %-6s %s\n", "board", "programmer", "index", "result" );
+	for( i = 0; i < count; i++ )
+	{
+		struct BatchBoard * b = &batch_boards[i];
+		if( b->failed )
+		{
+			printf( "%-6d %-14s %-6d FAIL (%s)\n", i, b->programmer, b->index, b->failed );
+			failed++;
+		}
+		else
+			printf( "%-6d %-14s %-6d PASS\n", i, b->programmer, b->index );
+	}
+	printf( "%d of %d passed\n", count - failed, count );
+
+	free( batch_image );
+	return failed;
+}
@@ -0,0 +1,337 @@
+// Throughput benchmark (-bench). Runs WriteBinaryBlob, ReadBinaryBlob, Erase
+// and BlockWrite64 through MCF over a spread of sizes and alignments, checks
+// each one did its job, and writes a CSV row per case with bytes per second
+// and how many WriteReg32s and ReadReg32s it took per KB. Compare two runs to
+// see what a change to a programmer or to DefaultWriteBinaryBlob() costs.
+//
+// Programmers that do the work themselves (B003Fun, the ESP32S2's block
+// writes) only count the register accesses that still go through MCF. The
+// ones without a BlockWrite64 run its cases as 64 byte WriteBinaryBlobs, the
+// way DefaultWriteBinaryBlob() writes whole blocks.
+//
+// On the simulator (-C sim) time is what the simulator works out the real
+// chip and wire would take, not how long the host took, so runs compare
+// exactly. Everywhere else it is the wall clock.
+//
+// Built on its own (make minichbench) it is a harness that runs the suite on
+// the simulator, or with -C on a programmer, and with -B compares the result
+// against a baseline, exiting nonzero if any case got more than -t percent
+// slower, took more round trips or stopped working.
+//
+// Usage: minichbench [-C programmer] [-c port] [-B baseline.csv] [-t percent] results.csv
+//   -h  print the usage
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "terminalhelp.h"
+#include "minichlink.h"
+
+#define BENCH_MIN_BYTES 1024 // Small cases are repeated until they move this much
+#define BENCH_MAX_SIZE  4096
+#define MAX_BENCH_ROWS  128
+
+enum BenchOp
+{
+	BENCH_WRITE,
+	BENCH_READ,
+	BENCH_ERASE,
+	BENCH_ERASE_CHIP,
+	BENCH_BLOCK64,
+};
+
+static const char * bench_op_names[] = { "write", "read", "erase", "erase_chip", "block64" };
+
+static const int bench_sizes[] = { 64, 256, 1024, 4096 };
+static const int bench_aligns[] = { 0, 1, 2, 4 };
+
+static int (*bench_write_reg)( void * dev, uint8_t reg_7_bit, uint32_t command );
+static int (*bench_read_reg)( void * dev, uint8_t reg_7_bit, uint32_t * commandresp );
+static uint64_t bench_writes;
+static uint64_t bench_reads;
+static struct SimulatorStats * bench_sim;
+static uint8_t bench_data[BENCH_MAX_SIZE];
+static uint8_t bench_check[BENCH_MAX_SIZE];
+
+static int BenchWriteReg32( void * dev, uint8_t reg_7_bit, uint32_t command )
+{
+	bench_writes++;
+	return bench_write_reg( dev, reg_7_bit, command );
+}
+
+static int BenchReadReg32( void * dev, uint8_t reg_7_bit, uint32_t * commandresp )
+{
+	bench_reads++;
+	return bench_read_reg( dev, reg_7_bit, commandresp );
+}
+
+static uint64_t BenchNowNS()
+{
+	if( bench_sim )
+		return bench_sim->wire_ns + bench_sim->target_ns + bench_sim->flash_ns + bench_sim->delay_ns;
+	return GetTimeMicroseconds() * 1000;
+}
+
+// Different bytes for every case, the same every run
+static void BenchFill( uint32_t seed, int len )
+{
+	uint32_t x = seed * 2654435761u | 1;
+	int i;
+	for( i = 0; i < len; i++ )
+	{
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		bench_data[i] = x;
+	}
+}
+
+// Returns 1 if the case checked out, 0 if not.
+static int BenchCase( void * dev, FILE * csv, enum BenchOp op, const char * region, uint32_t base, int size, int align )
+{
+	uint32_t address = base + align;
+	int checklen = ( size < BENCH_MAX_SIZE ) ? size : BENCH_MAX_SIZE;
+	int reps = ( size < BENCH_MIN_BYTES ) ? BENCH_MIN_BYTES / size : 1;
+	int rep, i, r = 0, ok;
+	uint64_t start, ns, writes, reads;
+
+	BenchFill( ( op << 24 ) ^ ( size << 4 ) ^ align, checklen );
+
+	// Something to read back, or for the erase to get rid of.
+	if( op == BENCH_READ || op == BENCH_ERASE || op == BENCH_ERASE_CHIP )
+		r = MCF.WriteBinaryBlob( dev, address, checklen, bench_data );
+	if( MCF.FlushLLCommands ) MCF.FlushLLCommands( dev );
+
+	bench_writes = bench_reads = 0;
+	start = BenchNowNS();
+	for( rep = 0; rep < reps && !r; rep++ )
+	{
+		switch( op )
+		{
+		case BENCH_WRITE:
+			r = MCF.WriteBinaryBlob( dev, address, size, bench_data );
+			break;
+		case BENCH_READ:
+			r = MCF.ReadBinaryBlob( dev, address, size, bench_check );
+			break;
+		case BENCH_ERASE:
+			r = MCF.Erase( dev, address, size, 0 );
+			break;
+		case BENCH_ERASE_CHIP:
+			r = MCF.Erase( dev, address, size, 1 );
+			break;
+		case BENCH_BLOCK64:
+			for( i = 0; i < size && !r; i += 64 )
+				r = MCF.BlockWrite64 ? MCF.BlockWrite64( dev, address + i, bench_data + i ) :
+					MCF.WriteBinaryBlob( dev, address + i, 64, bench_data + i );
+			break;
+		}
+	}
+	if( MCF.FlushLLCommands ) MCF.FlushLLCommands( dev );
+	ns = BenchNowNS() - start;
+	writes = bench_writes;
+	reads = bench_reads;
+
+	// Checked outside of the measurement
+	if( op == BENCH_ERASE || op == BENCH_ERASE_CHIP )
+		memset( bench_data, 0xff, checklen );
+	if( !r && op != BENCH_READ )
+		r = MCF.ReadBinaryBlob( dev, address, checklen, bench_check );
+	ok = !r && memcmp( bench_check, bench_data, checklen ) == 0;
+
+	double bytes = (double)size * reps;
+	double bps = ns ? bytes * 1e9 / ns : 0;
+	fprintf( csv, "%s,%s,%d,%d,%d,%llu,%.0f,%.1f,%.1f,%d\n", bench_op_names[op], region, size, align, reps,
+		(unsigned long long)( ns / 1000 ), bps, writes * 1024.0 / bytes, reads * 1024.0 / bytes, ok );
+	fprintf( stderr, "%-10s %-5s %5d +%d %10.0f bytes/s %8.1f writes/KB %8.1f reads/KB%s\n", bench_op_names[op], region, size, align,
+		bps, writes * 1024.0 / bytes, reads * 1024.0 / bytes, ok ? "" : " FAILED" );
+	return ok;
+}
+
+int RunBenchmark( void * dev, const char * csvname, struct SimulatorStats * sim )
+{
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	int s, a, failed = 0;
+	FILE * csv = fopen( csvname, "w" );
+	if( !csv )
+	{
+		fprintf( stderr, "Error: Could not open %s\n", csvname );
+		return -55;
+	}
+	if( !MCF.WriteBinaryBlob || !MCF.ReadBinaryBlob )
+	{
+		fprintf( stderr, "Error: This programmer can't read and write memory\n" );
+		fclose( csv );
+		return -5;
+	}
+
+	bench_sim = sim;
+	bench_write_reg = MCF.WriteReg32;
+	bench_read_reg = MCF.ReadReg32;
+	if( bench_write_reg ) MCF.WriteReg32 = BenchWriteReg32;
+	if( bench_read_reg ) MCF.ReadReg32 = BenchReadReg32;
+
+	if( MCF.HaltMode ) MCF.HaltMode( dev, HALT_MODE_HALT_AND_RESET );
+
+	fprintf( csv, "op,region,size,align,reps,time_us,bytes_per_sec,writes_per_kb,reads_per_kb,ok\n" );
+	for( s = 0; s < sizeof( bench_sizes ) / sizeof( bench_sizes[0] ); s++ )
+	{
+		int size = bench_sizes[s];
+		for( a = 0; a < sizeof( bench_aligns ) / sizeof( bench_aligns[0] ); a++ )
+		{
+			int align = bench_aligns[a];
+			if( size + align <= iss->flash_size )
+			{
+				failed += !BenchCase( dev, csv, BENCH_WRITE, "flash", 0x08000000, size, align );
+				failed += !BenchCase( dev, csv, BENCH_READ, "flash", 0x08000000, size, align );
+			}
+			if( size + align <= iss->ram_size )
+			{
+				failed += !BenchCase( dev, csv, BENCH_WRITE, "ram", iss->ram_base, size, align );
+				failed += !BenchCase( dev, csv, BENCH_READ, "ram", iss->ram_base, size, align );
+			}
+		}
+		// Both work in whole sectors and blocks. The erase goes last, so the
+		// next size starts on erased flash either way.
+		if( size <= iss->flash_size )
+			failed += !BenchCase( dev, csv, BENCH_BLOCK64, "flash", 0x08000000, size, 0 );
+		if( MCF.Erase && size <= iss->flash_size )
+			failed += !BenchCase( dev, csv, BENCH_ERASE, "flash", 0x08000000, size, 0 );
+	}
+	if( MCF.Erase )
+		failed += !BenchCase( dev, csv, BENCH_ERASE_CHIP, "flash", 0x08000000, iss->flash_size, 0 );
+
+	MCF.WriteReg32 = bench_write_reg;
+	MCF.ReadReg32 = bench_read_reg;
+	bench_sim = 0;
+	fclose( csv );
+
+	if( failed )
+		fprintf( stderr, "Error: %d case%s did not check out\n", failed, ( failed == 1 ) ? "" : "s" );
+	return failed;
+}
+
+#if defined( MINICHBENCH_MAIN )
+
+struct BenchResult
+{
+	char name[48];
+	double bytes_per_sec;
+	double round_trips_per_kb;
+	int ok;
+};
+
+static int BenchLoad( const char * fname, struct BenchResult * res )
+{
+	char line[256];
+	int n = 0;
+	FILE * f = fopen( fname, "r" );
+	if( !f )
+	{
+		fprintf( stderr, "Error: Could not open %s\n", fname );
+		return -1;
+	}
+	while( fgets( line, sizeof( line ), f ) && n < MAX_BENCH_ROWS )
+	{
+		char op[16], region[16];
+		int size, align, reps, ok;
+		unsigned long long us;
+		double bps, writes, reads;
+		if( sscanf( line, "%15[^,],%15[^,],%d,%d,%d,%llu,%lf,%lf,%lf,%d", op, region, &size, &align, &reps, &us, &bps, &writes, &reads, &ok ) != 10 ) continue;
+		snprintf( res[n].name, sizeof( res[n].name ), "%s %s %d+%d", op, region, size, align );
+		res[n].bytes_per_sec = bps;
+		res[n].round_trips_per_kb = writes + reads;
+		res[n].ok = ok;
+		n++;
+	}
+	fclose( f );
+	return n;
+}
+
+// Returns how many cases got worse than the baseline.
+static int BenchCompare( const char * fname, const char * baseline, double threshold )
+{
+	static struct BenchResult now[MAX_BENCH_ROWS], was[MAX_BENCH_ROWS];
+	int nnow = BenchLoad( fname, now );
+	int nwas = BenchLoad( baseline, was );
+	int i, j, worse = 0;
+	if( nnow < 0 || nwas < 0 ) return 1;
+
+	for( i = 0; i < nwas; i++ )
+	{
+		struct BenchResult * w = &was[i];
+		struct BenchResult * n = 0;
+		for( j = 0; j < nnow; j++ )
+			if( strcmp( now[j].name, w->name ) == 0 ) n = &now[j];
+
+		if( !n )
+			printf( "%-24s missing\n", w->name );
+		else if( w->ok && !n->ok )
+			printf( "%-24s no longer checks out\n", w->name );
+		else if( n->bytes_per_sec * 100 < w->bytes_per_sec * ( 100 - threshold ) )
+			printf( "%-24s %.0f -> %.0f bytes/s\n", w->name, w->bytes_per_sec, n->bytes_per_sec );
+		else if( n->round_trips_per_kb * 100 > w->round_trips_per_kb * ( 100 + threshold ) )
+			printf( "%-24s %.1f -> %.1f round trips/KB\n", w->name, w->round_trips_per_kb, n->round_trips_per_kb );
+		else
+			continue;
+		worse++;
+	}
+	printf( "%d of %d cases worse than %s\n", worse, nwas, baseline );
+	return worse;
+}
+
+int main( int argc, char ** argv )
+{
+	init_hints_t hints;
+	const char * csvname = 0, * baseline = 0;
+	double threshold = 5;
+	int i, r;
+
+	memset( &hints, 0, sizeof( hints ) );
+	hints.specific_programmer = "sim";
+	for( i = 1; i < argc; i++ )
+	{
+		const char * a = argv[i];
+		if( a[0] != '-' )
+			csvname = a;
+		else if( a[1] && !a[2] && strchr( "CcBt", a[1] ) && i + 1 < argc )
+		{
+			const char * v = argv[++i];
+			switch( a[1] )
+			{
+			case 'C': hints.specific_programmer = v; break;
+			case 'c': hints.serial_port = v; break;
+			case 'B': baseline = v; break;
+			case 't': threshold = atof( v ); break;
+			}
+		}
+		else
+		{
+			// -h, or anything else it doesn't know
+			csvname = 0;
+			break;
+		}
+	}
+	if( !csvname )
+	{
+		fprintf( stderr, "Usage: %s [-C programmer, default sim] [-c port] [-B baseline.csv] [-t percent] results.csv\n", argv[0] );
+		return -1;
+	}
+
+	void * dev = MiniCHLinkInitAsDLL( 0, &hints );
+	if( !dev ) return -32;
+	if( MCF.SetupInterface && MCF.SetupInterface( dev ) < 0 )
+	{
+		fprintf( stderr, "Could not setup interface.\n" );
+		return -33;
+	}
+	PostSetupConfigureInterface( dev );
+
+	r = RunBenchmark( dev, csvname, strcmp( hints.specific_programmer, "sim" ) ? 0 : SimulatorGetStats( dev ) );
+	if( MCF.Exit ) MCF.Exit( dev );
+	if( r ) return r;
+
+	return ( baseline && BenchCompare( csvname, baseline, threshold ) ) ? 1 : 0;
+}
+
+#endif
@@ -11,6 +11,7 @@
 #include "terminalhelp.h"
 #include "minichlink.h"
 #include "../ch32v003fun/ch32v003fun.h"
+#include "../extralibs/swio_upload.h"
 
 #if defined(WINDOWS) || defined(WIN32) || defined(_WIN32)
 #ifndef _SYNCHAPI_H_
@@ -25,9 +26,10 @@ void Sleep(uint32_t dwMilliseconds);
 static int64_t StringToMemoryAddress( const char * number ) __attribute__((used));
 static void StaticUpdatePROGBUFRegs( void * dev ) __attribute__((used));
 int DefaultReadBinaryBlob( void * dev, uint32_t address_to_read_from, uint32_t read_size, uint8_t * blob );
-void PostSetupConfigureInterface( void * dev );
 void TestFunction(void * v );
-struct MiniChlinkFunctions MCF;
+static int SWIOUploadSend( void * dev, uint8_t region, const uint8_t * data, int len ) __attribute__((used));
+static uint32_t CRC32Update( uint32_t crc, const uint8_t * data, int len );
+MINICHLINK_TLS struct MiniChlinkFunctions MCF;
 
 void * MiniCHLinkInitAsDLL( struct MiniChlinkFunctions ** MCFO, const init_hints_t* init_hints )
 {
@@ -37,23 +39,25 @@ void * MiniCHLinkInitAsDLL( struct MiniChlinkFunctions ** MCFO, const init_hints
 	if( specpgm )
 	{
 		if( strcmp( specpgm, "linke" ) == 0 )
-			dev = TryInit_WCHLinkE();
+			dev = TryInit_WCHLinkE( init_hints );
 		else if( strcmp( specpgm, "esp32s2chfun" ) == 0 )
-			dev = TryInit_ESP32S2CHFUN();
+			dev = TryInit_ESP32S2CHFUN( init_hints );
 		else if( strcmp( specpgm, "nchlink" ) == 0 )
 			dev = TryInit_NHCLink042();
 		else if( strcmp( specpgm, "b003boot" ) == 0 )
-			dev = TryInit_B003Fun();
+			dev = TryInit_B003Fun( init_hints );
 		else if( strcmp( specpgm, "ardulink" ) == 0 )
-			dev = TryInit_B003Fun();
+			dev = TryInit_B003Fun( init_hints );
+		else if( strcmp( specpgm, "sim" ) == 0 )
+			dev = TryInit_Simulator( init_hints );
 	}
 	else
 	{
-		if( (dev = TryInit_WCHLinkE()) )
+		if( (dev = TryInit_WCHLinkE( init_hints )) )
 		{
 			fprintf( stderr, "Found WCH Link\n" );
 		}
-		else if( (dev = TryInit_ESP32S2CHFUN()) )
+		else if( (dev = TryInit_ESP32S2CHFUN( init_hints )) )
 		{
 			fprintf( stderr, "Found ESP32S2 Programmer\n" );
 		}
@@ -61,7 +65,7 @@ void * MiniCHLinkInitAsDLL( struct MiniChlinkFunctions ** MCFO, const init_hints
 		{
 			fprintf( stderr, "Found NHC-Link042 Programmer\n" );
 		}
-		else if ((dev = TryInit_B003Fun()))
+		else if ((dev = TryInit_B003Fun( init_hints )))
 		{
 			fprintf( stderr, "Found B003Fun Bootloader\n" );
 		}
@@ -77,14 +81,7 @@ void * MiniCHLinkInitAsDLL( struct MiniChlinkFunctions ** MCFO, const init_hints
 		return 0;
 	}
 
-	struct InternalState * iss = calloc( 1, sizeof( struct InternalState ) );
-	((struct ProgrammerStructBase*)dev)->internal = iss;
-	iss->ram_base = 0x20000000;
-	iss->ram_size = 2048;
-	iss->sector_size = 64;
-	iss->flash_size = 16384;
-	iss->target_chip_type = 0;
-
+	SetupInternalState( dev );
 	SetupAutomaticHighLevelFunctions( dev );
 
 	if( MCFO )
@@ -94,6 +91,17 @@ void * MiniCHLinkInitAsDLL( struct MiniChlinkFunctions ** MCFO, const init_hints
 	return dev;
 }
 
+void SetupInternalState( void * dev )
+{
+	struct InternalState * iss = calloc( 1, sizeof( struct InternalState ) );
+	((struct ProgrammerStructBase*)dev)->internal = iss;
+	iss->ram_base = 0x20000000;
+	iss->ram_size = 2048;
+	iss->sector_size = 64;
+	iss->flash_size = 16384;
+	iss->target_chip_type = 0;
+}
+
 #if !defined( MINICHLINK_AS_LIBRARY ) && !defined( MINICHLINK_IMPORT )
 int main( int argc, char ** argv )
 {
@@ -148,6 +156,19 @@ int main( int argc, char ** argv )
 	}
 #endif
 
+	// Batch mode opens every programmer itself
+	if( argc > 1 && argv[1][0] == '-' && argv[1][1] == 'M' )
+	{
+		if( argc < 4 ) goto help;
+		uint64_t offset = StringToMemoryAddress( argv[3] );
+		if( offset > 0xffffffff )
+		{
+			fprintf( stderr, "Error: Invalid offset (%s)\n", argv[3] );
+			return -44;
+		}
+		return BatchFlash( &hints, argv[2], offset ) ? -1 : 0;
+	}
+
 	void * dev = MiniCHLinkInitAsDLL( 0, &hints );
 	if( !dev )
 	{
@@ -195,7 +216,19 @@ int main( int argc, char ** argv )
 			fprintf( stderr, "Error: the command '%c' cannot be followed by other commands.\n", must_be_end );
 			return -1;
 		}
-		
+
+		// Read as one word, not -b -e -n -c -h
+		if( strcmp( argchar, "-bench" ) == 0 )
+		{
+			iarg++;
+			if( iarg >= argc ) goto help;
+			struct SimulatorStats * sim = 0;
+			if( hints.specific_programmer && strcmp( hints.specific_programmer, "sim" ) == 0 )
+				sim = SimulatorGetStats( dev );
+			if( RunBenchmark( dev, argv[iarg], sim ) ) return -15;
+			continue;
+		}
+
 keep_going:
 		switch( argchar[1] )
 		{
@@ -375,6 +408,53 @@ keep_going:
 					ExitGDBServer( dev );
 				break;
 			}
+			case 'S':
+			{
+				iarg+=2;
+				argchar = 0; // Stop advancing
+				if( iarg >= argc )
+				{
+					fprintf( stderr, "Error: -S needs a file and a region.\n" );
+					goto help;
+				}
+				if( !MCF.PollTerminal || !MCF.ReadReg32 || !MCF.WriteReg32 )
+					goto unimplemented;
+
+				const char * fname = argv[iarg-1];
+				int region = SimpleReadNumberInt( argv[iarg], -1 );
+				if( region < 0 || region > 255 )
+				{
+					fprintf( stderr, "Error: Bad region (%s)\n", argv[iarg] );
+					return -9;
+				}
+				FILE * f = fopen( fname, "rb" );
+				if( !f )
+				{
+					fprintf( stderr, "Error: Could not open %s\n", fname );
+					return -55;
+				}
+				fseek( f, 0, SEEK_END );
+				int len = ftell( f );
+				fseek( f, 0, SEEK_SET );
+				uint8_t * image = malloc( len + 1 );
+				status = fread( image, len, 1, f );
+				fclose( f );
+				if( len > 0xffffff || ( len && status != 1 ) )
+				{
+					fprintf( stderr, "Error: File I/O Fault.\n" );
+					return -10;
+				}
+
+				// In case we aren't running already.
+				MCF.HaltMode( dev, HALT_MODE_RESUME );
+				if( SWIOUploadSend( dev, region, image, len ) )
+				{
+					free( image );
+					return -13;
+				}
+				free( image );
+				break;
+			}
 			case 's':
 			{
 				iarg+=2;
@@ -539,8 +619,10 @@ keep_going:
 				break;
 			}
 			case 'w':
+			case 'W':
 			{
 				struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+				int diff = argchar[1] == 'W';
 				if( argchar[2] != 0 ) goto help;
 				iarg++;
 				argchar = 0; // Stop advancing
@@ -638,7 +720,7 @@ keep_going:
 
 				if( MCF.WriteBinaryBlob )
 				{
-					if( MCF.WriteBinaryBlob( dev, offset, len, image ) )
+					if( diff ? DiffWriteBinaryBlob( dev, offset, len, image ) : MCF.WriteBinaryBlob( dev, offset, len, image ) )
 					{
 						fprintf( stderr, "Error: Fault writing image.\n" );
 						return -13;
@@ -654,6 +736,53 @@ keep_going:
 				free( image );
 				break;
 			}
+			case 'V':
+			{
+				iarg += 2;
+				argchar = 0; // Stop advancing
+				if( iarg >= argc ) goto help;
+
+				const char * fname = argv[iarg-1];
+				uint64_t offset = StringToMemoryAddress( argv[iarg] );
+				if( offset > 0xffffffff )
+				{
+					fprintf( stderr, "Error: Invalid offset (%s)\n", argv[iarg] );
+					return -44;
+				}
+				FILE * f = fopen( fname, "rb" );
+				if( !f )
+				{
+					fprintf( stderr, "Error: Could not open %s\n", fname );
+					return -55;
+				}
+				fseek( f, 0, SEEK_END );
+				int len = ftell( f );
+				fseek( f, 0, SEEK_SET );
+				uint8_t * image = malloc( len + 1 );
+				status = fread( image, len, 1, f );
+				fclose( f );
+				if( len && status != 1 )
+				{
+					fprintf( stderr, "Error: File I/O Fault.\n" );
+					return -10;
+				}
+
+				if( MCF.HaltMode ) MCF.HaltMode( dev, HALT_MODE_HALT_BUT_NO_RESET );
+				int r = VerifyBinaryBlob( dev, offset, len, image );
+				free( image );
+				if( r < 0 )
+				{
+					fprintf( stderr, "Error: Fault verifying image.\n" );
+					return -12;
+				}
+				if( r )
+				{
+					fprintf( stderr, "Error: Image does not match.\n" );
+					return -14;
+				}
+				printf( "Image verified.\n" );
+				break;
+			}
 			
 		}
 		if( argchar && argchar[2] != 0 ) { argchar++; goto keep_going; }
@@ -676,7 +805,7 @@ help:
 	fprintf( stderr, " -t Disable 3.3V\n" );
 	fprintf( stderr, " -f Disable 5V\n" );
 	fprintf( stderr, " -c [serial port for Ardulink, try /dev/ttyACM0 or COM11 etc]\n" );
-	fprintf( stderr, " -C [specified programmer, eg. b003boot, ardulink, esp32s2chfun]\n" );
+	fprintf( stderr, " -C [specified programmer, eg. b003boot, ardulink, esp32s2chfun, or sim for no hardware]\n" );
 	fprintf( stderr, " -u Clear all code flash - by power off (also can unbrick)\n" );
 	fprintf( stderr, " -E Erase chip\n" );
 	fprintf( stderr, " -b Reboot out of Halt\n" );
@@ -689,10 +818,17 @@ help:
 	fprintf( stderr, " -s [debug register] [value]\n" );
 	fprintf( stderr, " -m [debug register]\n" );
 	fprintf( stderr, " -T Terminal Only\n" );
+	fprintf( stderr, " -S [file] [region] Send a file to a running program, see extralibs/swio_upload.h\n" );
 	fprintf( stderr, " -G Terminal + GDB\n" );
 	fprintf( stderr, " -P Enable Read Protection\n" );
 	fprintf( stderr, " -p Disable Read Protection\n" );
 	fprintf( stderr, " -w [binary image to write] [address, decimal or 0x, try0x08000000]\n" );
+	fprintf( stderr, " -W [binary image to write] [address] Like -w, but only rewrites sectors that changed\n" );
+	fprintf( stderr, " -V [binary image] [address] Check the target holds the image, by CRC-32 where possible\n" );
+	fprintf( stderr, " -M [binary image to write] [address] Unbrick, erase, write and verify through\n" );
+	fprintf( stderr, "   every attached programmer at once. Must come first, -C picks one kind.\n" );
+	fprintf( stderr, " -bench [output csv] Time reads, writes and erases of all sizes. Overwrites\n" );
+	fprintf( stderr, "   the start of flash and RAM. Try with -C sim, or make minichbench to compare runs.\n" );
 	fprintf( stderr, " -r [output binary image] [memory address, decimal or 0x, try 0x08000000] [size, decimal or 0x, try 16384]\n" );
 	fprintf( stderr, "   Note: for memory addresses, you can use 'flash' 'launcher' 'bootloader' 'option' 'ram' and say \"ram+0x10\" for instance\n" );
 	fprintf( stderr, "   For filename, you can use - for raw (terminal) or + for hex (inline).\n" );
@@ -1112,6 +1248,88 @@ static int DefaultWriteWord( void * dev, uint32_t address_to_write, uint32_t dat
 	return ret;
 }
 
+int VerifyBinaryBlob( void * dev, uint32_t address, uint32_t length, const uint8_t * blob )
+{
+	// The CRC code runs from the start of RAM, so only trust it for flash.
+	if( MCF.CRC32 && IsAddressFlash( address ) )
+	{
+		uint32_t crc = 0xffffffff;
+		if( MCF.CRC32( dev, address, length, &crc ) == 0 )
+			return crc != CRC32Update( 0xffffffff, blob, length );
+		fprintf( stderr, "Warning: CRC32 on target failed, reading back instead\n" );
+	}
+	if( !MCF.ReadBinaryBlob ) return -5;
+
+	uint8_t * readback = malloc( length + 1 );
+	int r = ( MCF.ReadBinaryBlob( dev, address, length, readback ) < 0 ) ? -5 : ( memcmp( readback, blob, length ) != 0 );
+	free( readback );
+	return r;
+}
+
+// Like MCF.WriteBinaryBlob, but reads the flash back first and leaves alone
+// every sector that already holds the right bytes. Only the rest get erased
+// and programmed, a run of neighbouring sectors at a time.
+int DiffWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob_size, uint8_t * blob )
+{
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	int sectorsize = iss->sector_size;
+
+	if( address_to_write < 0x01000000 )
+		address_to_write |= 0x08000000;
+
+	// Option bytes get written very carefully anyway, and RAM has no sectors.
+	if( blob_size == 0 || !IsAddressFlash( address_to_write ) || address_to_write > 0x1ffff7c0 )
+		return MCF.WriteBinaryBlob( dev, address_to_write, blob_size, blob );
+
+	uint32_t end = address_to_write + blob_size;
+	int sectors = ( end - 1 ) / sectorsize - address_to_write / sectorsize + 1;
+
+	// Nothing to read back if the whole image is already there
+	if( MCF.CRC32 && VerifyBinaryBlob( dev, address_to_write, blob_size, blob ) == 0 )
+	{
+		printf( "0 of %d sectors changed\n", sectors );
+		return 0;
+	}
+
+	uint8_t * current = malloc( blob_size );
+	if( MCF.ReadBinaryBlob( dev, address_to_write, blob_size, current ) < 0 )
+	{
+		fprintf( stderr, "Warning: Could not read back flash, writing all of it\n" );
+		free( current );
+		return MCF.WriteBinaryBlob( dev, address_to_write, blob_size, blob );
+	}
+
+	uint32_t sector = address_to_write & ~( sectorsize - 1 );
+	uint32_t run_start = 0;
+	int in_run = 0;
+	int changed = 0;
+	int r = 0;
+
+	for( ; sector < end && !r; sector += sectorsize )
+	{
+		uint32_t s = ( sector < address_to_write ) ? address_to_write : sector;
+		uint32_t e = ( sector + sectorsize > end ) ? end : sector + sectorsize;
+		int differs = memcmp( current + ( s - address_to_write ), blob + ( s - address_to_write ), e - s ) != 0;
+		if( differs )
+		{
+			changed++;
+			if( !in_run ) run_start = s;
+			in_run = 1;
+		}
+		else if( in_run )
+		{
+			r = MCF.WriteBinaryBlob( dev, run_start, s - run_start, blob + ( run_start - address_to_write ) );
+			in_run = 0;
+		}
+	}
+	if( in_run && !r )
+		r = MCF.WriteBinaryBlob( dev, run_start, end - run_start, blob + ( run_start - address_to_write ) );
+
+	free( current );
+	if( !r ) printf( "%d of %d sectors changed\n", changed, sectors );
+	return r;
+}
+
 int DefaultWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob_size, uint8_t * blob )
 {
 	// NOTE IF YOU FIX SOMETHING IN THIS FUNCTION PLEASE ALSO UPDATE THE PROGRAMMERS.
@@ -1329,7 +1547,6 @@ int DefaultWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob
 					for( j = 0; j < sectorsize/4; j++ )
 					{
 						MCF.WriteWord( dev, j*4+base, *(uint32_t*)(tempblock + j * 4) );
-						rsofar += 4;
 					}
 					MCF.WriteWord( dev, 0x40022014, base );  //0x40022014 -> FLASH->ADDR
 					MCF.WriteWord( dev, 0x40022010, CR_PAGE_PG|CR_STRT_Set ); // 0x40022010 -> FLASH->CTLR
@@ -1747,6 +1964,68 @@ int DefaultSetEnableBreakpoints( void * dev, int is_enabled, int single_step )
 	return 0;
 }
 
+// Run from the start of RAM with a1 = address, a2 = length, a3 = crc, which
+// is left in a3 when it hits the ebreak.
+static const uint32_t crc32_ram_code[] = {
+	0xedb887b7, //       lui a5,0xedb88
+	0x32078793, //       addi a5,a5,0x320
+	0x02060a63, // loop: beqz a2,done
+	0x0005c703, //       lbu a4,0(a1)
+	0x00e6c6b3, //       xor a3,a3,a4
+	0x00800293, //       li t0,8
+	0x0016f713, // bit:  andi a4,a3,1
+	0x0016d693, //       srli a3,a3,1
+	0x00070463, //       beqz a4,skip
+	0x00f6c6b3, //       xor a3,a3,a5
+	0xfff28293, // skip: addi t0,t0,-1
+	0xfe0296e3, //       bnez t0,bit
+	0x00158593, //       addi a1,a1,1
+	0xfff60613, //       addi a2,a2,-1
+	0xfd1ff06f, //       j loop
+	0x00100073, // done: ebreak
+};
+
+int DefaultCRC32( void * dev, uint32_t address, uint32_t length, uint32_t * crc )
+{
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	uint32_t dmstatus = 0;
+	int i, r;
+
+	if( length == 0 ) return 0;
+
+	for( i = 0; i < sizeof( crc32_ram_code ) / 4; i++ )
+		if( MCF.WriteWord( dev, iss->ram_base + i * 4, crc32_ram_code[i] ) ) return -5;
+	MCF.WriteCPURegister( dev, 0x100b, address );
+	MCF.WriteCPURegister( dev, 0x100c, length );
+	MCF.WriteCPURegister( dev, 0x100d, *crc );
+	MCF.WriteCPURegister( dev, 0x7b1, iss->ram_base ); // dpc
+	MCF.SetEnableBreakpoints( dev, 1, 0 );
+	MCF.VoidHighLevelState( dev );
+
+	MCF.WriteReg32( dev, DMCONTROL, 0x40000001 ); // resumereq
+	MCF.FlushLLCommands( dev );
+
+	// Wait for it to take the resume, then to stop at the ebreak. 16kB takes
+	// about 100ms at 8MHz.
+	for( i = 0; ; i++ )
+	{
+		if( MCF.ReadReg32( dev, DMSTATUS, &dmstatus ) ) return -5;
+		if( ( dmstatus & ( 1<<17 ) ) && ( dmstatus & ( 1<<9 ) ) ) break;
+		if( i > 5000 )
+		{
+			fprintf( stderr, "Error: CRC32 on target timed out (DMSTATUS %08x)\n", dmstatus );
+			MCF.WriteReg32( dev, DMCONTROL, 0x80000001 ); // Halt it where it is
+			MCF.FlushLLCommands( dev );
+			return -6;
+		}
+		MCF.DelayUS( dev, 1000 );
+	}
+	MCF.WriteReg32( dev, DMCONTROL, 0x80000001 ); // Leave it halt requested, like HaltMode
+	r = MCF.ReadCPURegister( dev, 0x100d, crc );
+	MCF.VoidHighLevelState( dev );
+	return r;
+}
+
 
 static int DefaultHaltMode( void * dev, int mode )
 {
@@ -1857,6 +2136,125 @@ int DefaultPollTerminal( void * dev, uint8_t * buffer, int maxlen, uint32_t leav
 	}
 }
 
+// Hand one 7-byte frame to the target's poll_input(), once it has taken the
+// last one. Anything the target prints in the meantime goes to stdout.
+static int SWIOUploadFrame( void * dev, const uint8_t * frame )
+{
+	uint32_t w0 = ( SWIO_UPLOAD_FRAME + 4 ) | ( frame[0] << 8 ) | ( frame[1] << 16 ) | ( (uint32_t)frame[2] << 24 );
+	uint32_t w1 = frame[3] | ( frame[4] << 8 ) | ( frame[5] << 16 ) | ( (uint32_t)frame[6] << 24 );
+	int tries;
+	for( tries = 0; tries < 20000; tries++ )
+	{
+		uint32_t rr;
+		int r = MCF.ReadReg32( dev, DMDATA0, &rr );
+		if( r < 0 ) return r;
+		if( rr & 0x80 )
+		{
+			// Target is printing. Our frame doubles as the ack.
+			uint8_t buffer[16];
+			r = MCF.PollTerminal( dev, buffer, sizeof( buffer ), w0, w1 );
+			if( r < -1 ) return r;
+			if( r > 0 ) fwrite( buffer, r, 1, stdout );
+			return 0;
+		}
+		if( ( rr & 0x3f ) <= 4 )
+		{
+			MCF.WriteReg32( dev, DMDATA1, w1 );
+			MCF.WriteReg32( dev, DMDATA0, w0 );
+			return 0;
+		}
+		// Still holding the last frame, maybe busy writing flash
+		if( tries > 16 ) MCF.DelayUS( dev, 100 );
+	}
+	return -1;
+}
+
+// CRC-32 (zlib), without the inversions at either end
+static uint32_t CRC32Update( uint32_t crc, const uint8_t * data, int len )
+{
+	int i, b;
+	for( i = 0; i < len; i++ )
+	{
+		crc ^= data[i];
+		for( b = 0; b < 8; b++ )
+			crc = ( crc >> 1 ) ^ ( 0xEDB88320 & -( crc & 1 ) );
+	}
+	return crc;
+}
+
+static int SWIOUploadSend( void * dev, uint8_t region, const uint8_t * data, int len )
+{
+	uint8_t frame[SWIO_UPLOAD_FRAME] = { SWIO_UPLOAD_START, region, len, len >> 8, len >> 16 };
+	uint32_t crc = ~CRC32Update( 0xffffffff, data, len );
+	char line[64];
+	int linelen = 0;
+	int place, waited;
+
+	if( SWIOUploadFrame( dev, frame ) )
+	{
+		fprintf( stderr, "Error: Target is not taking input. Is it running, and calling SWIOUploadRun()?\n" );
+		return -1;
+	}
+	for( place = 0; place < len; place += SWIO_UPLOAD_FRAME - 1 )
+	{
+		int n = len - place;
+		if( n > SWIO_UPLOAD_FRAME - 1 ) n = SWIO_UPLOAD_FRAME - 1;
+		memset( frame, 0, sizeof( frame ) );
+		frame[0] = ( place / ( SWIO_UPLOAD_FRAME - 1 ) ) & 0x7f;
+		memcpy( frame + 1, data + place, n );
+		if( SWIOUploadFrame( dev, frame ) )
+		{
+			fprintf( stderr, "Error: Upload stalled at byte %d of %d\n", place, len );
+			return -1;
+		}
+	}
+	memset( frame, 0, sizeof( frame ) );
+	frame[0] = SWIO_UPLOAD_END;
+	memcpy( frame + 1, &crc, 4 );
+	if( SWIOUploadFrame( dev, frame ) )
+	{
+		fprintf( stderr, "Error: Upload stalled at the end\n" );
+		return -1;
+	}
+
+	// Wait for the target's verdict, about two seconds at most
+	for( waited = 0; waited < 20000; waited++ )
+	{
+		uint8_t buffer[16];
+		int r = MCF.PollTerminal( dev, buffer, sizeof( buffer ), 0, 0 );
+		int i;
+		if( r < -1 ) return r;
+		if( r <= 0 )
+		{
+			MCF.DelayUS( dev, 100 );
+			continue;
+		}
+		for( i = 0; i < r; i++ )
+		{
+			if( buffer[i] != '\n' )
+			{
+				if( linelen < sizeof( line ) - 1 ) line[linelen++] = buffer[i];
+				continue;
+			}
+			line[linelen] = 0;
+			linelen = 0;
+			if( strcmp( line, "UPLOAD OK" ) == 0 )
+			{
+				printf( "Sent %d bytes.\n", len );
+				return 0;
+			}
+			if( strncmp( line, "UPLOAD ERR", 10 ) == 0 )
+			{
+				fprintf( stderr, "Error: Target refused the upload (%s)\n", line );
+				return -1;
+			}
+			printf( "%s\n", line );
+		}
+	}
+	fprintf( stderr, "Error: No reply from target after the upload\n" );
+	return -1;
+}
+
 int DefaultUnbrick( void * dev )
 {
 	printf( "Entering Unbrick Mode\n" );
@@ -1869,6 +2267,11 @@ int DefaultUnbrick( void * dev )
 	MCF.Control3v3( dev, 1 );
 	MCF.DelayUS( dev, 100 );
 	MCF.FlushLLCommands( dev );
+
+	// Nothing we left in the processor or the flash controller survived that.
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	if( MCF.VoidHighLevelState ) MCF.VoidHighLevelState( dev );
+	iss->flash_unlocked = 0;
 	printf( "Connection starting\n" );
 	int timeout = 0;
 	int max_timeout = 500;
@@ -2042,6 +2445,8 @@ int SetupAutomaticHighLevelFunctions( void * dev )
 		MCF.VoidHighLevelState = DefaultVoidHighLevelState;
 	if( !MCF.DelayUS )
 		MCF.DelayUS = DefaultDelayUS;
+	if( !MCF.CRC32 && MCF.WriteReg32 && MCF.ReadReg32 )
+		MCF.CRC32 = DefaultCRC32;
 
 	return 0;
 }
@@ -31,6 +31,11 @@ struct MiniChlinkFunctions
 
 	int (*Erase)( void * dev, uint32_t address, uint32_t length, int type ); //type = 0 for fast, 1 for whole-chip
 
+	// CRC-32 (zlib) worked out on the target, so nothing has to be read back.
+	// *crc carries on from where it is, start it at 0xffffffff and invert it
+	// at the end. May use the start of RAM and leave the processor halted.
+	int (*CRC32)( void * dev, uint32_t address, uint32_t length, uint32_t * crc );
+
 	// MUST be 4-byte-aligned.
 	int (*VoidHighLevelState)( void * dev );
 	int (*WriteWord)( void * dev, uint32_t address_to_write, uint32_t data );
@@ -172,21 +177,67 @@ struct InternalState
 typedef struct {
 	const char * serial_port;
 	const char * specific_programmer;
+	int programmer_index; // Open the Nth attached programmer of a kind, from 0
 } init_hints_t;
 
+// MCF is per thread, so batch mode (-M) can drive a different programmer from
+// each thread. Tiny C has no thread locals, there batch mode goes one by one.
+#if defined( __TINYC__ )
+#define MINICHLINK_TLS
+#define MINICHLINK_NO_THREADS
+#else
+#define MINICHLINK_TLS __thread
+#endif
+
 void * MiniCHLinkInitAsDLL(struct MiniChlinkFunctions ** MCFO, const init_hints_t* init_hints) DLLDECORATE;
-extern struct MiniChlinkFunctions MCF;
+extern MINICHLINK_TLS struct MiniChlinkFunctions MCF;
 
 // Returns 'dev' on success, else 0.
-void * TryInit_WCHLinkE(void);
-void * TryInit_ESP32S2CHFUN(void);
+void * TryInit_WCHLinkE(const init_hints_t*);
+void * TryInit_ESP32S2CHFUN(const init_hints_t*);
 void * TryInit_NHCLink042(void);
-void * TryInit_B003Fun(void);
+void * TryInit_B003Fun(const init_hints_t*);
 void * TryInit_Ardulink(const init_hints_t*);
+void * TryInit_Simulator(const init_hints_t*);
+
+// What the simulated programmer (-C sim, pgm-sim.c) has done so far
+struct SimulatorStats
+{
+	uint64_t reg_writes; // WriteReg32s, one SWIO transaction each
+	uint64_t reg_reads;  // ReadReg32s
+	uint64_t wire_ns;    // Time those transactions take on the wire
+	uint64_t target_ns;  // Time the target spends running code, at 8MHz
+	uint64_t flash_ns;   // Time the flash takes to erase and program
+	uint64_t delay_ns;   // Time asked for with DelayUS
+};
+struct SimulatorStats * SimulatorGetStats( void * dev );
+
+// Writes only the sectors that differ from what is in flash (-W).
+int DiffWriteBinaryBlob( void * dev, uint32_t address_to_write, uint32_t blob_size, uint8_t * blob );
+
+// 0 if the target holds blob at address, 1 if it doesn't, negative on fault.
+// Uses MCF.CRC32 if there is one, else reads it all back (-V).
+int VerifyBinaryBlob( void * dev, uint32_t address, uint32_t length, const uint8_t * blob );
+
+// Read, write and erase throughput for a spread of sizes and alignments, as
+// CSV (-bench, see minichbench.c). Overwrites the start of flash and RAM. sim
+// gives the simulator's stats to time by, or 0 for the wall clock. Returns
+// the number of cases that did not check out, or negative on a fault.
+int RunBenchmark( void * dev, const char * csvname, struct SimulatorStats * sim );
+
+// Gives a freshly opened 'dev' its InternalState.
+void SetupInternalState( void * dev );
+
+// Call after SetupInterface.
+void PostSetupConfigureInterface( void * dev );
 
 // Returns 0 if ok, populated, 1 if not populated.
 int SetupAutomaticHighLevelFunctions( void * dev );
 
+// Unbrick, erase, write and verify through every attached programmer at
+// once, see minichbatch.c. Returns the number of boards that failed.
+int BatchFlash( const init_hints_t * hints, const char * fname, uint32_t offset );
+
 // Useful for converting numbers like 0x, etc.
 int64_t SimpleReadNumberInt( const char * number, int64_t defaultNumber );
 
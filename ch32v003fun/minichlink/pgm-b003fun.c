@@ -9,6 +9,9 @@
 
 //#define DEBUG_B003
 
+// In pgm-esp32s2-ch32xx.c
+hid_device * HIDOpenNth( unsigned short vid, unsigned short pid, const wchar_t * serial, int index );
+
 #if defined(WINDOWS) || defined(WIN32) || defined(_WIN32)
 void Sleep(uint32_t dwMilliseconds);
 #define usleep( x ) Sleep( x / 1000 );
@@ -100,6 +103,34 @@ static const unsigned char run_app_blob[] = {
 	0x00, 0xe0, 0x37, 0x07, 0x00, 0x80, 0x23, 0xa8, 0xe7, 0xd0, 0x82, 0x80,
 };
 
+// CRC-32 (zlib) of length bytes at address, carrying on from crc, which goes
+// back in its place. Parameters follow the blob, at 96: address, length, crc.
+static const unsigned char crc32_blob[] = {
+	0x23, 0xa0, 0x05, 0x00, //       sw zero,0(a1)
+	0x83, 0x25, 0x05, 0x06, //       lw a1,96(a0)
+	0x03, 0x26, 0x45, 0x06, //       lw a2,100(a0)
+	0x83, 0x26, 0x85, 0x06, //       lw a3,104(a0)
+	0xb7, 0x87, 0xb8, 0xed, //       lui a5,0xedb88
+	0x93, 0x87, 0x07, 0x32, //       addi a5,a5,0x320
+	0x63, 0x0a, 0x06, 0x02, // loop: beqz a2,done
+	0x03, 0xc7, 0x05, 0x00, //       lbu a4,0(a1)
+	0xb3, 0xc6, 0xe6, 0x00, //       xor a3,a3,a4
+	0x93, 0x02, 0x80, 0x00, //       li t0,8
+	0x13, 0xf7, 0x16, 0x00, // bit:  andi a4,a3,1
+	0x93, 0xd6, 0x16, 0x00, //       srli a3,a3,1
+	0x63, 0x04, 0x07, 0x00, //       beqz a4,skip
+	0xb3, 0xc6, 0xf6, 0x00, //       xor a3,a3,a5
+	0x93, 0x82, 0xf2, 0xff, // skip: addi t0,t0,-1
+	0xe3, 0x96, 0x02, 0xfe, //       bnez t0,bit
+	0x93, 0x85, 0x15, 0x00, //       addi a1,a1,1
+	0x13, 0x06, 0xf6, 0xff, //       addi a2,a2,-1
+	0x6f, 0xf0, 0x1f, 0xfd, //       j loop
+	0x23, 0x24, 0xd5, 0x06, // done: sw a3,104(a0)
+	0x93, 0x06, 0xf0, 0xff, //       li a3,-1
+	0x23, 0x20, 0xd5, 0x00, //       sw a3,0(a0)
+	0x67, 0x80, 0x00, 0x00, //       ret
+};
+
 
 static void ResetOp( struct B003FunProgrammerStruct * eps )
 {
@@ -394,6 +425,28 @@ static int B003FunReadBinaryBlob( void * dev, uint32_t address_to_read_from, uin
 	return 0;
 }
 
+// Bitwise on the target, so a chunk at a time keeps each one well inside
+// CommitOp()'s wait.
+static int B003FunCRC32( void * dev, uint32_t address, uint32_t length, uint32_t * crc )
+{
+	struct B003FunProgrammerStruct * eps = (struct B003FunProgrammerStruct *)dev;
+
+	while( length )
+	{
+		uint32_t chunk = ( length > 512 ) ? 512 : length;
+		ResetOp( eps );
+		WriteOpArb( eps, crc32_blob, sizeof(crc32_blob) );
+		WriteOp4( eps, address );
+		WriteOp4( eps, chunk );
+		WriteOp4( eps, *crc );
+		if( CommitOp( eps ) ) return -5;
+		memcpy( crc, &eps->respbuffer[104], 4 );
+		address += chunk;
+		length -= chunk;
+	}
+	return 0;
+}
+
 static int InternalB003FunBoot( void * dev )
 {
 	struct B003FunProgrammerStruct * eps = (struct B003FunProgrammerStruct*) dev;
@@ -538,12 +591,12 @@ int B003FunPrepForLongOp( void * dev )
 }
 
 
-void * TryInit_B003Fun()
+void * TryInit_B003Fun( const init_hints_t* hints )
 {
 	#define VID 0x1209
 	#define PID 0xb003
 	hid_init();
-	hid_device * hd = hid_open( VID, PID, 0); // third parameter is "serial"
+	hid_device * hd = HIDOpenNth( VID, PID, 0, hints->programmer_index ); // third parameter is "serial"
 	if( !hd ) return 0;
 
 	//extern int g_hidapiSuppress;
@@ -579,6 +632,7 @@ void * TryInit_B003Fun()
 	MCF.WaitForDoneOp = B003FunWaitForDoneOp;
 	MCF.BlockWrite64 = B003FunBlockWrite64;
 	MCF.ReadBinaryBlob = B003FunReadBinaryBlob;
+	MCF.CRC32 = B003FunCRC32;
 
 	MCF.PrepForLongOp = B003FunPrepForLongOp;
 
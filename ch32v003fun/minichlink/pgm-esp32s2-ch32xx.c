@@ -18,6 +18,26 @@ struct ESP32ProgrammerStruct
 
 int ESPFlushLLCommands( void * dev );
 
+// hid_open(), but for the Nth matching device, counting from 0. Shared with
+// pgm-b003fun.c, since hidapi.c is compiled in here.
+hid_device * HIDOpenNth( unsigned short vid, unsigned short pid, const wchar_t * serial, int index )
+{
+	struct hid_device_info * devs = hid_enumerate( vid, pid );
+	struct hid_device_info * d;
+	hid_device * hd = 0;
+	for( d = devs; d; d = d->next )
+	{
+		if( serial && ( !d->serial_number || wcscmp( serial, d->serial_number ) ) ) continue;
+		if( index-- == 0 )
+		{
+			hd = hid_open_path( d->path );
+			break;
+		}
+	}
+	hid_free_enumeration( devs );
+	return hd;
+}
+
 static inline int SRemain( struct ESP32ProgrammerStruct * e )
 {
 	return sizeof( e->commandbuffer ) - e->commandplace - 2; //Need room for EOF.
@@ -405,12 +425,12 @@ int ESPPollTerminal( void * dev, uint8_t * buffer, int maxlen, uint32_t leavefla
 }
 
 
-void * TryInit_ESP32S2CHFUN()
+void * TryInit_ESP32S2CHFUN( const init_hints_t* hints )
 {
 	#define VID 0x303a
 	#define PID 0x4004
 	hid_init();
-	hid_device * hd = hid_open( VID, PID, L"s2-ch32xx-pgm-v0"); // third parameter is "serial"
+	hid_device * hd = HIDOpenNth( VID, PID, L"s2-ch32xx-pgm-v0", hints->programmer_index ); // third parameter is "serial"
 	if( !hd ) return 0;
 
 	struct ESP32ProgrammerStruct * eps = malloc( sizeof( struct ESP32ProgrammerStruct ) );
@@ -0,0 +1,562 @@
+// Simulated programmer (-C sim), for running minichlink without any hardware.
+//
+// WriteReg32 and ReadReg32 go straight to an in-process model of a CH32V003:
+// its debug module, an RV32EC hart, 16kB of flash, 2kB of RAM, the system
+// flash and option bytes, and the flash controller at 0x40022000. Abstract
+// commands and the program buffer run like they do on the chip, so every
+// high level function in minichlink.c runs against it unchanged. Code resumed
+// from the debugger runs too, until it stops on an ebreak or touches something
+// that isn't modelled, after which the hart is just left running.
+//
+// Nothing is slept for. Instead it adds up how long things would have taken,
+// see struct SimulatorStats. Every register access is one SWIO transaction.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "minichlink.h"
+#include "../ch32v003fun/ch32v003fun.h"
+
+// In minichlink.c
+int DefaultSetupInterface( void * dev );
+
+// Time for one bit on the wire. A transaction is a start bit, 7 address bits,
+// read/write, 32 data bits, parity and a stop.
+#ifndef SIM_SWIO_BIT_NS
+#define SIM_SWIO_BIT_NS 500
+#endif
+#define SIM_SWIO_BITS 43
+
+// 8MHz, the HSI divided by 3 that the chip comes out of reset with
+#define SIM_HCLK_NS 125
+
+// Rough flash timings, in the order of the datasheet's
+#define SIM_HALFWORD_PROGRAM_NS 50000
+#define SIM_PAGE_PROGRAM_NS     1500000
+#define SIM_PAGE_ERASE_NS       3000000
+#define SIM_MASS_ERASE_NS       40000000
+
+// Resumed code that runs this long is taken to be running for good
+#define SIM_MAX_RUN 20000000
+
+#define SIM_FLASH_SIZE   16384
+#define SIM_RAM_SIZE     2048
+#define SIM_INFO_BASE    0x1FFFF000 // Bootloader, ESIG and option bytes
+#define SIM_INFO_SIZE    0x840
+#define SIM_OB_BASE      0x1FFFF800
+#define SIM_DATA_ADDR    0xe00000f4 // DATA0 and DATA1, as reported in DMHARTINFO
+#define SIM_PROGBUF_ADDR 0xe00000c0 // Where the program buffer runs from
+
+#define SIM_FLASH_REGS   0x40022000
+#define SIM_FLASH_KEY1   0x45670123
+#define SIM_FLASH_KEY2   0xCDEF89AB
+#define SIM_CTLR_FLOCK   0x8000
+#define SIM_STATR_EOP    0x20
+#define SIM_STATR_LOCK   0x8000
+
+#define SIM_EBREAK    1
+#define SIM_EXCEPTION -1 // Same as RV32EC_ILLEGAL
+
+struct SimProgrammerStruct
+{
+	void * internal; // Part of struct ProgrammerStructBase
+
+	struct SimulatorStats stats;
+	int powered;
+
+	// Debug module
+	uint32_t data[2];
+	uint32_t progbuf[8];
+	uint32_t dmcontrol;
+	uint32_t command;
+	uint32_t abstractauto;
+	uint32_t cmderr;
+	uint32_t cfgr, shdwcfgr, cpbr;
+	int resumeack;
+	int havereset;
+
+	// Hart
+	uint32_t regs[16];
+	uint32_t pc;
+	uint32_t dpc;
+	uint32_t dcsr;
+	int halted;
+	uint64_t cycles;
+
+	// Memory
+	uint8_t flash[SIM_FLASH_SIZE];
+	uint8_t info[SIM_INFO_SIZE];
+	uint8_t ram[SIM_RAM_SIZE];
+
+	// Flash controller
+	uint32_t fctlr, fstatr, faddr, factlr;
+	int key_stage[4]; // KEYR, OBKEYR, MODEKEYR, BOOT_MODEKEYR
+	uint8_t page_buffer[64];
+	uint32_t staged_addr, staged_word;
+	int staged;
+};
+
+// Pointer to len bytes at addr, if addr is plain memory.
+static uint8_t * SimMemory( struct SimProgrammerStruct * s, uint32_t addr, int len )
+{
+	#define SIM_IN( base, size ) ( addr - (base) < (size) && addr - (base) + len <= (size) )
+	if( SIM_IN( 0, SIM_FLASH_SIZE ) ) return s->flash + addr;
+	if( SIM_IN( 0x08000000, SIM_FLASH_SIZE ) ) return s->flash + addr - 0x08000000;
+	if( SIM_IN( SIM_INFO_BASE, SIM_INFO_SIZE ) ) return s->info + addr - SIM_INFO_BASE;
+	if( SIM_IN( 0x20000000, SIM_RAM_SIZE ) ) return s->ram + addr - 0x20000000;
+	if( SIM_IN( SIM_DATA_ADDR, sizeof( s->data ) ) ) return (uint8_t*)s->data + addr - SIM_DATA_ADDR;
+	if( SIM_IN( SIM_PROGBUF_ADDR, sizeof( s->progbuf ) ) ) return (uint8_t*)s->progbuf + addr - SIM_PROGBUF_ADDR;
+	return 0;
+	#undef SIM_IN
+}
+
+static int SimIsFlash( struct SimProgrammerStruct * s, uint32_t addr )
+{
+	return addr < SIM_FLASH_SIZE || addr - 0x08000000 < SIM_FLASH_SIZE || addr - SIM_INFO_BASE < SIM_INFO_SIZE;
+}
+
+static void SimResetFlashController( struct SimProgrammerStruct * s )
+{
+	s->fctlr = FLASH_CTLR_LOCK | SIM_CTLR_FLOCK;
+	s->fstatr = SIM_STATR_LOCK;
+	s->faddr = 0;
+	s->factlr = 0;
+	s->staged = 0;
+	memset( s->key_stage, 0, sizeof( s->key_stage ) );
+	memset( s->page_buffer, 0xff, sizeof( s->page_buffer ) );
+}
+
+// Like the chip, a reset leaves the registers alone. minichlink counts on it.
+static void SimReset( struct SimProgrammerStruct * s )
+{
+	s->pc = 0;
+	s->dcsr = 0x40000003;
+	s->halted = 0;
+	s->havereset = 1;
+	SimResetFlashController( s );
+}
+
+// Programs the erased bits, like the real thing.
+static void SimProgram( uint8_t * to, const uint8_t * from, int len )
+{
+	int i;
+	for( i = 0; i < len; i++ ) to[i] &= from[i];
+}
+
+static void SimFlashStart( struct SimProgrammerStruct * s )
+{
+	uint32_t ctlr = s->fctlr;
+	uint8_t * page;
+
+	if( ctlr & FLASH_CTLR_MER )
+	{
+		memset( s->flash, 0xff, SIM_FLASH_SIZE );
+		s->stats.flash_ns += SIM_MASS_ERASE_NS;
+	}
+	else if( ctlr & FLASH_CTLR_OPTER )
+	{
+		if( !( ctlr & FLASH_CTLR_OPTWRE ) ) goto protect;
+		memset( s->info + SIM_OB_BASE - SIM_INFO_BASE, 0xff, 64 );
+		s->stats.flash_ns += SIM_PAGE_ERASE_NS;
+	}
+	else if( ctlr & FLASH_CTLR_PER )
+	{
+		if( !( page = SimMemory( s, s->faddr & ~1023, 1024 ) ) ) goto protect;
+		memset( page, 0xff, 1024 );
+		s->stats.flash_ns += SIM_PAGE_ERASE_NS;
+	}
+	else if( ctlr & ( CR_PAGE_ER | CR_PAGE_PG ) )
+	{
+		if( ( ctlr & SIM_CTLR_FLOCK ) || !( page = SimMemory( s, s->faddr & ~63, 64 ) ) ) goto protect;
+		if( ctlr & CR_PAGE_ER )
+			memset( page, 0xff, 64 );
+		else
+			SimProgram( page, s->page_buffer, 64 );
+		s->stats.flash_ns += ( ctlr & CR_PAGE_ER ) ? SIM_PAGE_ERASE_NS : SIM_PAGE_PROGRAM_NS;
+	}
+	s->fstatr |= SIM_STATR_EOP;
+	return;
+protect:
+	s->fstatr |= FLASH_STATR_WRPRTERR;
+}
+
+static void SimFlashCTLR( struct SimProgrammerStruct * s, uint32_t v )
+{
+	uint32_t locks = FLASH_CTLR_LOCK | SIM_CTLR_FLOCK;
+
+	// The locks only ever get set by writing, and OPTWRE only ever cleared.
+	v = ( v & ~( locks | FLASH_CTLR_OPTWRE ) ) | ( ( v | s->fctlr ) & locks ) | ( v & s->fctlr & FLASH_CTLR_OPTWRE );
+	if( s->fctlr & FLASH_CTLR_LOCK )
+	{
+		s->fctlr = v & ( locks | FLASH_CTLR_OPTWRE );
+		return;
+	}
+	s->fctlr = v & ~( CR_BUF_RST | CR_BUF_LOAD | CR_STRT_Set );
+
+	if( v & CR_BUF_RST )
+		memset( s->page_buffer, 0xff, sizeof( s->page_buffer ) );
+	if( ( v & CR_BUF_LOAD ) && s->staged )
+	{
+		memcpy( s->page_buffer + ( s->staged_addr & 0x3c ), &s->staged_word, 4 );
+		s->staged = 0;
+	}
+	if( v & CR_STRT_Set )
+		SimFlashStart( s );
+}
+
+static void SimFlashKey( struct SimProgrammerStruct * s, int which, uint32_t v )
+{
+	if( v == SIM_FLASH_KEY1 )
+	{
+		s->key_stage[which] = 1;
+		return;
+	}
+	if( v != SIM_FLASH_KEY2 || !s->key_stage[which] )
+	{
+		s->key_stage[which] = 0;
+		return;
+	}
+	s->key_stage[which] = 0;
+	switch( which )
+	{
+	case 0: s->fctlr &= ~FLASH_CTLR_LOCK; break;
+	case 1: s->fctlr |= FLASH_CTLR_OPTWRE; break;
+	case 2: s->fctlr &= ~SIM_CTLR_FLOCK; break;
+	case 3: s->fstatr &= ~SIM_STATR_LOCK; break;
+	}
+}
+
+static int SimLoad( struct SimProgrammerStruct * s, uint32_t addr, int len, uint32_t * v )
+{
+	uint8_t * m;
+	if( addr & ( len - 1 ) ) return SIM_EXCEPTION;
+	if( addr - SIM_FLASH_REGS < 0x30 )
+	{
+		if( len != 4 ) return SIM_EXCEPTION;
+		switch( addr - SIM_FLASH_REGS )
+		{
+		case 0x00: *v = s->factlr; break;
+		case 0x0c: *v = s->fstatr; break;
+		case 0x10: *v = s->fctlr; break;
+		case 0x14: *v = s->faddr; break;
+		case 0x20: *v = 0xffffffff; break; // WPR, nothing protected
+		default: *v = 0; break;
+		}
+		return 0;
+	}
+	if( !( m = SimMemory( s, addr, len ) ) ) return SIM_EXCEPTION;
+	*v = 0;
+	memcpy( v, m, len );
+	return 0;
+}
+
+static int SimStore( struct SimProgrammerStruct * s, uint32_t addr, int len, uint32_t v )
+{
+	uint8_t * m;
+	if( addr & ( len - 1 ) ) return SIM_EXCEPTION;
+	if( addr - SIM_FLASH_REGS < 0x30 )
+	{
+		if( len != 4 ) return SIM_EXCEPTION;
+		switch( addr - SIM_FLASH_REGS )
+		{
+		case 0x00: s->factlr = v; break;
+		case 0x04: SimFlashKey( s, 0, v ); break;
+		case 0x08: SimFlashKey( s, 1, v ); break;
+		case 0x0c: s->fstatr = ( s->fstatr & ~( v & ( SIM_STATR_EOP | FLASH_STATR_WRPRTERR ) ) & ~0x4000 ) | ( v & 0x4000 ); break;
+		case 0x10: SimFlashCTLR( s, v ); break;
+		case 0x14: s->faddr = v; break;
+		case 0x24: SimFlashKey( s, 2, v ); break;
+		case 0x28: SimFlashKey( s, 3, v ); break;
+		}
+		return 0;
+	}
+	if( !( m = SimMemory( s, addr, len ) ) ) return SIM_EXCEPTION;
+	if( !SimIsFlash( s, addr ) )
+	{
+		memcpy( m, &v, len );
+		return 0;
+	}
+
+	// Flash only takes writes while programming: words into the page buffer,
+	// or half words one at a time.
+	if( ( s->fctlr & CR_PAGE_PG ) && len == 4 )
+	{
+		s->staged = 1;
+		s->staged_addr = addr;
+		s->staged_word = v;
+		return 0;
+	}
+	if( ( ( s->fctlr & FLASH_CTLR_PG ) || ( ( s->fctlr & FLASH_CTLR_OPTPG ) && addr - SIM_OB_BASE < 64 ) ) && len == 2 )
+	{
+		SimProgram( m, (uint8_t*)&v, 2 );
+		s->stats.flash_ns += SIM_HALFWORD_PROGRAM_NS;
+		s->fstatr |= SIM_STATR_EOP;
+		return 0;
+	}
+	s->fstatr |= FLASH_STATR_WRPRTERR;
+	return SIM_EXCEPTION;
+}
+
+static int SimFetch( struct SimProgrammerStruct * s, uint32_t addr, uint32_t * v )
+{
+	uint8_t * m = SimMemory( s, addr, 2 );
+	if( !m ) return SIM_EXCEPTION;
+	*v = 0;
+	memcpy( v, m, 2 );
+	return 0;
+}
+
+// No CSRs or traps here, just ebreak.
+static int SimSystem( uint32_t ir )
+{
+	return ( ir == 0x00100073 ) ? SIM_EBREAK : SIM_EXCEPTION;
+}
+
+#define RV32EC_CTX struct SimProgrammerStruct *
+#define RV32EC_REG( s, n ) ( s )->regs[n]
+#define RV32EC_PC( s ) ( s )->pc
+#define RV32EC_CYCLES( s ) ( s )->cycles
+#define RV32EC_FETCH( s, addr, v ) SimFetch( s, addr, v )
+#define RV32EC_LOAD( s, addr, len, v ) SimLoad( s, addr, len, v )
+#define RV32EC_STORE( s, addr, len, v ) SimStore( s, addr, len, v )
+#define RV32EC_SYSTEM( s, ir, next, v ) SimSystem( ir )
+#include "rv32ec.h"
+
+static uint32_t * SimRegister( struct SimProgrammerStruct * s, uint32_t regno )
+{
+	if( regno >= 0x1000 && regno < 0x1010 ) return &s->regs[regno - 0x1000];
+	if( regno == 0x7b0 ) return &s->dcsr;
+	if( regno == 0x7b1 ) return &s->dpc;
+	return 0;
+}
+
+static void SimAbstractCommand( struct SimProgrammerStruct * s, uint32_t cmd )
+{
+	uint64_t start = s->cycles;
+	int i, r = 0;
+
+	if( s->cmderr ) return; // Nothing runs until the error is cleared
+	if( ( cmd >> 24 ) != 0 || ( ( cmd >> 20 ) & 7 ) != 2 )
+	{
+		s->cmderr = 2; // Only 32-bit register access is supported
+		return;
+	}
+	if( !s->halted )
+	{
+		s->cmderr = 4;
+		return;
+	}
+	if( cmd & ( 1<<17 ) )
+	{
+		uint32_t * reg = SimRegister( s, cmd & 0xffff );
+		if( !reg )
+		{
+			s->cmderr = 3;
+			return;
+		}
+		if( cmd & ( 1<<16 ) )
+			*reg = s->data[0];
+		else
+			s->data[0] = *reg;
+		s->regs[0] = 0;
+	}
+	if( cmd & ( 1<<18 ) )
+	{
+		// Running off the end of the program buffer is an ebreak too.
+		s->pc = SIM_PROGBUF_ADDR;
+		for( i = 0; i < 1000 && s->pc - SIM_PROGBUF_ADDR < sizeof( s->progbuf ) && !r; i++ )
+			r = RV32ECStep( s );
+		if( r == SIM_EXCEPTION || i == 1000 ) s->cmderr = 3;
+	}
+	s->stats.target_ns += ( s->cycles - start ) * SIM_HCLK_NS;
+}
+
+static void SimResume( struct SimProgrammerStruct * s )
+{
+	uint64_t start = s->cycles;
+	int i, r = 0;
+
+	s->halted = 0;
+	s->resumeack = 1;
+	s->pc = s->dpc;
+	for( i = 0; i < SIM_MAX_RUN && !r; i++ )
+		r = RV32ECStep( s );
+	s->stats.target_ns += ( s->cycles - start ) * SIM_HCLK_NS;
+
+	// Anything else leaves it running whatever it was running.
+	if( r == SIM_EBREAK && ( s->dcsr & ( 1<<15 ) ) )
+	{
+		s->halted = 1;
+		s->dpc = s->pc;
+		s->dcsr = ( s->dcsr & ~0x1c0 ) | ( 1<<6 ); // cause: ebreak
+	}
+}
+
+static void SimDMControl( struct SimProgrammerStruct * s, uint32_t v )
+{
+	s->dmcontrol = v & 0x03ffffff;
+	if( v & ( 1<<1 ) ) SimReset( s ); // ndmreset
+	if( v & ( 1<<28 ) ) s->havereset = 0; // ackhavereset
+	if( v & ( 1<<31 ) ) // haltreq
+	{
+		if( !s->halted )
+		{
+			s->halted = 1;
+			s->dpc = s->pc;
+			s->dcsr = ( s->dcsr & ~0x1c0 ) | ( 3<<6 ); // cause: haltreq
+		}
+	}
+	else if( v & ( 1<<30 ) ) // resumereq
+	{
+		s->resumeack = 0;
+		if( s->halted ) SimResume( s );
+	}
+}
+
+static int SimWriteReg32( void * dev, uint8_t reg_7_bit, uint32_t value )
+{
+	struct SimProgrammerStruct * s = (struct SimProgrammerStruct *)dev;
+	s->stats.reg_writes++;
+	s->stats.wire_ns += SIM_SWIO_BITS * SIM_SWIO_BIT_NS;
+	if( !s->powered ) return 0;
+
+	switch( reg_7_bit )
+	{
+	case DMDATA0:
+		s->data[0] = value;
+		if( s->abstractauto & 1 ) SimAbstractCommand( s, s->command );
+		break;
+	case DMDATA1: s->data[1] = value; break;
+	case DMCONTROL: SimDMControl( s, value ); break;
+	case DMABSTRACTCS: s->cmderr &= ~( ( value >> 8 ) & 7 ); break;
+	case DMCOMMAND:
+		s->command = value;
+		SimAbstractCommand( s, value );
+		break;
+	case DMABSTRACTAUTO: s->abstractauto = value; break;
+	case DMCPBR: s->cpbr = value; break;
+	case DMCFGR: s->cfgr = value; break;
+	case DMSHDWCFGR: s->shdwcfgr = value; break;
+	default:
+		if( reg_7_bit >= DMPROGBUF0 && reg_7_bit <= DMPROGBUF7 )
+			s->progbuf[reg_7_bit - DMPROGBUF0] = value;
+		break;
+	}
+	return 0;
+}
+
+static int SimReadReg32( void * dev, uint8_t reg_7_bit, uint32_t * value )
+{
+	struct SimProgrammerStruct * s = (struct SimProgrammerStruct *)dev;
+	s->stats.reg_reads++;
+	s->stats.wire_ns += SIM_SWIO_BITS * SIM_SWIO_BIT_NS;
+	*value = 0;
+	if( !s->powered ) return 0;
+
+	switch( reg_7_bit )
+	{
+	case DMDATA0:
+		*value = s->data[0];
+		if( s->abstractauto & 1 ) SimAbstractCommand( s, s->command );
+		break;
+	case DMDATA1: *value = s->data[1]; break;
+	case DMCONTROL: *value = s->dmcontrol; break;
+	case DMSTATUS:
+		*value = 0x00000082 | ( s->halted ? ( 3<<8 ) : ( 3<<10 ) ) | ( s->resumeack ? ( 3<<16 ) : 0 ) | ( s->havereset ? ( 3<<18 ) : 0 );
+		break;
+	case DMHARTINFO: *value = 0x00012000 | ( SIM_DATA_ADDR & 0x7ff ); break;
+	case DMABSTRACTCS: *value = ( 8<<24 ) | ( s->cmderr<<8 ) | 2; break;
+	case DMCOMMAND: *value = s->command; break;
+	case DMABSTRACTAUTO: *value = s->abstractauto; break;
+	case DMCPBR: *value = s->cpbr; break;
+	case DMCFGR: *value = s->cfgr; break;
+	case DMSHDWCFGR: *value = s->shdwcfgr; break;
+	default:
+		if( reg_7_bit >= DMPROGBUF0 && reg_7_bit <= DMPROGBUF7 )
+			*value = s->progbuf[reg_7_bit - DMPROGBUF0];
+		break;
+	}
+	return 0;
+}
+
+static int SimFlushLLCommands( void * dev )
+{
+	return 0;
+}
+
+static int SimDelayUS( void * dev, int microseconds )
+{
+	struct SimProgrammerStruct * s = (struct SimProgrammerStruct *)dev;
+	s->stats.delay_ns += (uint64_t)microseconds * 1000;
+	return 0;
+}
+
+static int SimControl3v3( void * dev, int bOn )
+{
+	struct SimProgrammerStruct * s = (struct SimProgrammerStruct *)dev;
+	if( bOn && !s->powered )
+	{
+		// RAM, registers and the debug module don't survive, and the chip starts up running.
+		memset( s->ram, 0xa5, sizeof( s->ram ) );
+		memset( s->regs, 0xa5, sizeof( s->regs ) );
+		memset( s->progbuf, 0, sizeof( s->progbuf ) );
+		memset( s->data, 0, sizeof( s->data ) );
+		SimReset( s );
+		s->cmderr = 0;
+		s->abstractauto = 0;
+		s->dmcontrol = 0;
+		s->resumeack = 0;
+	}
+	s->powered = bOn;
+	return 0;
+}
+
+static int SimSetupInterface( void * dev )
+{
+	struct InternalState * iss = (struct InternalState*)(((struct ProgrammerStructBase*)dev)->internal);
+	iss->target_chip_type = CHIP_CH32V003;
+	return DefaultSetupInterface( dev );
+}
+
+static int SimExit( void * dev )
+{
+	struct SimProgrammerStruct * s = (struct SimProgrammerStruct *)dev;
+	struct SimulatorStats * st = &s->stats;
+	fprintf( stderr, "Simulator: %llu register writes, %llu reads. %.3f ms on the wire, %.3f ms running code, %.3f ms in flash operations, %.3f ms in delays\n",
+		(unsigned long long)st->reg_writes, (unsigned long long)st->reg_reads,
+		st->wire_ns / 1e6, st->target_ns / 1e6, st->flash_ns / 1e6, st->delay_ns / 1e6 );
+	free( s );
+	return 0;
+}
+
+struct SimulatorStats * SimulatorGetStats( void * dev )
+{
+	return &((struct SimProgrammerStruct *)dev)->stats;
+}
+
+void * TryInit_Simulator( const init_hints_t * hints )
+{
+	struct SimProgrammerStruct * s = calloc( 1, sizeof( struct SimProgrammerStruct ) );
+	static const uint8_t option_bytes[16] = { 0xa5, 0x5a, 0x97, 0x68, 0x00, 0xff, 0x00, 0xff, 0xff, 0x00, 0xff, 0x00, 0xff, 0x00, 0xff, 0x00 };
+	static const uint8_t esig[20] = { 16, 0, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x53, 0x49, 0x4d, 0x31, 0xcd, 0xab, 0x34, 0x12, 0x78, 0x56, 0x00, 0x00 };
+
+	// A board that's already powered, running a blank chip
+	memset( s->flash, 0xff, sizeof( s->flash ) );
+	memset( s->info, 0xff, sizeof( s->info ) );
+	memcpy( s->info + 0x7e0, esig, sizeof( esig ) ); // Flash size and unique ID
+	memcpy( s->info + SIM_OB_BASE - SIM_INFO_BASE, option_bytes, sizeof( option_bytes ) );
+	SimReset( s );
+	s->havereset = 0;
+	s->powered = 1;
+
+	memset( &MCF, 0, sizeof( MCF ) );
+	MCF.WriteReg32 = SimWriteReg32;
+	MCF.ReadReg32 = SimReadReg32;
+	MCF.FlushLLCommands = SimFlushLLCommands;
+	MCF.DelayUS = SimDelayUS;
+	MCF.Control3v3 = SimControl3v3;
+	MCF.SetupInterface = SimSetupInterface;
+	MCF.Exit = SimExit;
+
+	return s;
+}
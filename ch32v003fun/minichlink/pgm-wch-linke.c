@@ -119,7 +119,7 @@ static void wch_link_multicommands( libusb_device_handle * devh, int nrcommands,
 	va_end( argp );
 }
 
-static inline libusb_device_handle * wch_link_base_setup( int inhibit_startup )
+static inline libusb_device_handle * wch_link_base_setup( int inhibit_startup, int index )
 {
 	libusb_context * ctx = 0;
 	int status;
@@ -134,6 +134,7 @@ static inline libusb_device_handle * wch_link_base_setup( int inhibit_startup )
 	ssize_t i = 0;
 
 	libusb_device *found = NULL;
+	int found_count = 0;
 	libusb_device * found_arm_programmer = NULL;
 	libusb_device * found_programmer_in_iap = NULL;
 
@@ -141,13 +142,16 @@ static inline libusb_device_handle * wch_link_base_setup( int inhibit_startup )
 		libusb_device *device = list[i];
 		struct libusb_device_descriptor desc;
 		int r = libusb_get_device_descriptor(device,&desc);
-		if( r == 0 && desc.idVendor == 0x1a86 && desc.idProduct == 0x8010 ) { found = device; }
+		if( r == 0 && desc.idVendor == 0x1a86 && desc.idProduct == 0x8010 && found_count++ == index ) { found = device; }
 		if( r == 0 && desc.idVendor == 0x1a86 && desc.idProduct == 0x8012) { found_arm_programmer = device; }
 		if( r == 0 && desc.idVendor == 0x4348 && desc.idProduct == 0x55e0) { found_programmer_in_iap = device; }
 	}
 
 	if( !found )
 	{
+		// Only out of programmers, when looking for another one.
+		if( index > 0 ) return 0;
+
 		// On a lark see if we have a programmer which got stuck in IAP mode.
 
 		if (found_arm_programmer) {
@@ -550,10 +554,10 @@ int LEExit( void * d )
 	return 0;
 }
 
-void * TryInit_WCHLinkE()
+void * TryInit_WCHLinkE( const init_hints_t* hints )
 {
 	libusb_device_handle * wch_linke_devh;
-	wch_linke_devh = wch_link_base_setup(0);
+	wch_linke_devh = wch_link_base_setup( 0, hints->programmer_index );
 	if( !wch_linke_devh ) return 0;
 
 	struct LinkEProgrammerStruct * ret = malloc( sizeof( struct LinkEProgrammerStruct ) );
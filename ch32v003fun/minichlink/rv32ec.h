@@ -0,0 +1,265 @@
+// RV32EC decoder and executor, shared by the simulated programmer (pgm-sim.c)
+// and the benchmark simulator (tools/rv32ec_sim.c).
+//
+// The includer says where the hart lives and how memory behaves by defining
+// these before including it:
+//
+//   RV32EC_CTX                    Type of the first argument to RV32ECStep()
+//   RV32EC_REG( c, n )            Register n, n < 16, as an lvalue
+//   RV32EC_PC( c )                The pc, as an lvalue
+//   RV32EC_CYCLES( c )            Cycle counter, as an lvalue
+//   RV32EC_FETCH( c, addr, v )    Read the halfword at addr into *v
+//   RV32EC_LOAD( c, addr, len, v ) Read len bytes at addr into *v
+//   RV32EC_STORE( c, addr, len, v ) Write the low len bytes of v to addr
+//   RV32EC_SYSTEM( c, ir, next, v ) Run a system instruction (opcode 0x73).
+//                                 It can change *next, and *v is written to rd.
+//
+// The hooks return 0, or nonzero to stop the instruction without retiring
+// it. RV32ECStep() then returns that value, with pc left on the instruction.
+//
+// Cycles are counted as one per instruction, plus one for loads and stores,
+// plus two for taken branches and jumps. Anything else, like flash wait
+// states, is up to the hooks.
+
+#ifndef _RV32EC_H
+#define _RV32EC_H
+
+#include <stdint.h>
+
+#define RV32EC_ILLEGAL -1
+
+// Expand a 16-bit compressed instruction into its 32-bit equivalent, 0 if
+// it's illegal.
+static uint32_t RV32ECExpand( uint16_t c )
+{
+	uint32_t rd = ( c >> 7 ) & 0x1f, rs2 = ( c >> 2 ) & 0x1f;
+	uint32_t rdp = 8 + ( ( c >> 2 ) & 7 ), rs1p = 8 + ( ( c >> 7 ) & 7 );
+	uint32_t f3 = c >> 13;
+	uint32_t imm;
+	switch( c & 3 )
+	{
+	case 0:
+		switch( f3 )
+		{
+		case 0: // c.addi4spn
+			imm = ( ( c >> 7 ) & 0x30 ) | ( ( c >> 1 ) & 0x3c0 ) | ( ( c >> 4 ) & 4 ) | ( ( c >> 2 ) & 8 );
+			if( !imm ) break;
+			return ( imm << 20 ) | ( 2 << 15 ) | ( rdp << 7 ) | 0x13;
+		case 2: // c.lw
+			imm = ( ( c >> 7 ) & 0x38 ) | ( ( c >> 4 ) & 4 ) | ( ( c << 1 ) & 0x40 );
+			return ( imm << 20 ) | ( rs1p << 15 ) | ( 2 << 12 ) | ( rdp << 7 ) | 0x03;
+		case 6: // c.sw
+			imm = ( ( c >> 7 ) & 0x38 ) | ( ( c >> 4 ) & 4 ) | ( ( c << 1 ) & 0x40 );
+			return ( ( imm >> 5 ) << 25 ) | ( rdp << 20 ) | ( rs1p << 15 ) | ( 2 << 12 ) | ( ( imm & 0x1f ) << 7 ) | 0x23;
+		}
+		break;
+	case 1:
+		imm = ( ( c >> 2 ) & 0x1f ) | ( ( c & 0x1000 ) ? ~0x1f : 0 );
+		switch( f3 )
+		{
+		case 0: // c.addi
+			return ( imm << 20 ) | ( rd << 15 ) | ( rd << 7 ) | 0x13;
+		case 1: // c.jal
+		case 5: // c.j
+			imm = ( ( c >> 1 ) & 0x800 ) | ( ( c << 2 ) & 0x400 ) | ( ( c >> 1 ) & 0x300 ) | ( ( c << 1 ) & 0x80 ) |
+				( ( c >> 1 ) & 0x40 ) | ( ( c << 3 ) & 0x20 ) | ( ( c >> 7 ) & 0x10 ) | ( ( c >> 2 ) & 0xe );
+			if( imm & 0x800 ) imm |= ~0x7ff;
+			return ( ( imm & 0x100000 ) << 11 ) | ( ( imm & 0x7fe ) << 20 ) | ( ( imm & 0x800 ) << 9 ) | ( imm & 0xff000 ) |
+				( ( f3 == 1 ? 1 : 0 ) << 7 ) | 0x6f;
+		case 2: // c.li
+			return ( imm << 20 ) | ( rd << 7 ) | 0x13;
+		case 3:
+			if( rd == 2 ) // c.addi16sp
+			{
+				imm = ( ( c >> 3 ) & 0x200 ) | ( ( c >> 2 ) & 0x10 ) | ( ( c << 1 ) & 0x40 ) | ( ( c << 4 ) & 0x180 ) | ( ( c << 3 ) & 0x20 );
+				if( imm & 0x200 ) imm |= ~0x3ff;
+				if( !imm ) break;
+				return ( imm << 20 ) | ( 2 << 15 ) | ( 2 << 7 ) | 0x13;
+			}
+			// c.lui
+			if( !imm ) break;
+			return ( imm << 12 ) | ( rd << 7 ) | 0x37;
+		case 4:
+			switch( ( c >> 10 ) & 3 )
+			{
+			case 0: // c.srli
+				return ( ( imm & 0x1f ) << 20 ) | ( rs1p << 15 ) | ( 5 << 12 ) | ( rs1p << 7 ) | 0x13;
+			case 1: // c.srai
+				return ( 0x20 << 25 ) | ( ( imm & 0x1f ) << 20 ) | ( rs1p << 15 ) | ( 5 << 12 ) | ( rs1p << 7 ) | 0x13;
+			case 2: // c.andi
+				return ( imm << 20 ) | ( rs1p << 15 ) | ( 7 << 12 ) | ( rs1p << 7 ) | 0x13;
+			case 3:
+			{
+				static const uint32_t ops[4] = { ( 0x20 << 25 ) | ( 0 << 12 ), 4 << 12, 6 << 12, 7 << 12 }; // sub xor or and
+				if( c & 0x1000 ) break;
+				return ops[( c >> 5 ) & 3] | ( rdp << 20 ) | ( rs1p << 15 ) | ( rs1p << 7 ) | 0x33;
+			}
+			}
+			break;
+		case 6: // c.beqz
+		case 7: // c.bnez
+			imm = ( ( c >> 4 ) & 0x100 ) | ( ( c << 1 ) & 0xc0 ) | ( ( c << 3 ) & 0x20 ) | ( ( c >> 7 ) & 0x18 ) | ( ( c >> 2 ) & 6 );
+			if( imm & 0x100 ) imm |= ~0xff;
+			return ( ( imm & 0x1000 ) << 19 ) | ( ( imm & 0x7e0 ) << 20 ) | ( rs1p << 15 ) | ( ( f3 & 1 ) << 12 ) |
+				( ( imm & 0x1e ) << 7 ) | ( ( imm & 0x800 ) >> 4 ) | 0x63;
+		}
+		break;
+	case 2:
+		switch( f3 )
+		{
+		case 0: // c.slli
+			return ( rs2 << 20 ) | ( rd << 15 ) | ( 1 << 12 ) | ( rd << 7 ) | 0x13;
+		case 2: // c.lwsp
+			imm = ( ( c >> 7 ) & 0x20 ) | ( ( c >> 2 ) & 0x1c ) | ( ( c << 4 ) & 0xc0 );
+			if( !rd ) break;
+			return ( imm << 20 ) | ( 2 << 15 ) | ( 2 << 12 ) | ( rd << 7 ) | 0x03;
+		case 4:
+			if( !( c & 0x1000 ) )
+			{
+				if( !rs2 ) // c.jr
+					return rd ? ( rd << 15 ) | 0x67 : 0;
+				return ( rs2 << 20 ) | ( rd << 7 ) | 0x33; // c.mv
+			}
+			if( !rd && !rs2 ) return 0x00100073; // c.ebreak
+			if( !rs2 ) return ( rd << 15 ) | ( 1 << 7 ) | 0x67; // c.jalr
+			return ( rs2 << 20 ) | ( rd << 15 ) | ( rd << 7 ) | 0x33; // c.add
+		case 6: // c.swsp
+			imm = ( ( c >> 7 ) & 0x3c ) | ( ( c >> 1 ) & 0xc0 );
+			return ( ( imm >> 5 ) << 25 ) | ( rs2 << 20 ) | ( 2 << 15 ) | ( 2 << 12 ) | ( ( imm & 0x1f ) << 7 ) | 0x23;
+		}
+		break;
+	}
+	return 0;
+}
+
+// Run one instruction. Returns 0, RV32EC_ILLEGAL or whatever a hook stopped
+// it with.
+static int RV32ECStep( RV32EC_CTX c )
+{
+	uint32_t here = RV32EC_PC( c );
+	uint32_t ir, hi, next, rs1, rs2, v = 0;
+	uint32_t op, rd, r1, r2;
+	int uses_rd, uses_rs1, uses_rs2;
+	int32_t imm;
+	int r;
+
+	if( here & 1 ) return RV32EC_ILLEGAL;
+	if( ( r = RV32EC_FETCH( c, here, &ir ) ) ) return r;
+	if( ( ir & 3 ) == 3 )
+	{
+		if( ( r = RV32EC_FETCH( c, here + 2, &hi ) ) ) return r;
+		ir |= hi << 16;
+		next = here + 4;
+	}
+	else
+	{
+		if( !( ir = RV32ECExpand( ir ) ) ) return RV32EC_ILLEGAL;
+		next = here + 2;
+	}
+
+	// RV32E only has 16 registers.
+	op = ir & 0x7f;
+	rd = ( ir >> 7 ) & 0x1f;
+	r1 = ( ir >> 15 ) & 0x1f;
+	r2 = ( ir >> 20 ) & 0x1f;
+	uses_rd = ( op != 0x63 && op != 0x23 && op != 0x0f );
+	uses_rs1 = ( op != 0x37 && op != 0x17 && op != 0x6f && op != 0x0f && !( op == 0x73 && ( ir & 0x4000 ) ) );
+	uses_rs2 = ( op == 0x63 || op == 0x23 || op == 0x33 );
+	if( ( uses_rd && rd > 15 ) || ( uses_rs1 && r1 > 15 ) || ( uses_rs2 && r2 > 15 ) )
+		return RV32EC_ILLEGAL;
+	rs1 = RV32EC_REG( c, r1 & 15 );
+	rs2 = RV32EC_REG( c, r2 & 15 );
+	RV32EC_CYCLES( c )++;
+
+	switch( op )
+	{
+	case 0x37: // lui
+		v = ir & 0xfffff000;
+		break;
+	case 0x17: // auipc
+		v = here + ( ir & 0xfffff000 );
+		break;
+	case 0x6f: // jal
+		imm = ( ( ir & 0x80000000 ) ? 0xfff00000 : 0 ) | ( ir & 0xff000 ) | ( ( ir >> 9 ) & 0x800 ) | ( ( ir >> 20 ) & 0x7fe );
+		v = next;
+		next = here + imm;
+		RV32EC_CYCLES( c ) += 2;
+		break;
+	case 0x67: // jalr
+		v = next;
+		next = ( rs1 + ( (int32_t)ir >> 20 ) ) & ~1;
+		RV32EC_CYCLES( c ) += 2;
+		break;
+	case 0x63: // branches
+	{
+		int take = 0;
+		imm = ( ( ir & 0x80000000 ) ? 0xfffff000 : 0 ) | ( ( ir << 4 ) & 0x800 ) | ( ( ir >> 20 ) & 0x7e0 ) | ( ( ir >> 7 ) & 0x1e );
+		switch( ( ir >> 12 ) & 7 )
+		{
+		case 0: take = rs1 == rs2; break;
+		case 1: take = rs1 != rs2; break;
+		case 4: take = (int32_t)rs1 < (int32_t)rs2; break;
+		case 5: take = (int32_t)rs1 >= (int32_t)rs2; break;
+		case 6: take = rs1 < rs2; break;
+		case 7: take = rs1 >= rs2; break;
+		default: return RV32EC_ILLEGAL;
+		}
+		if( take )
+		{
+			next = here + imm;
+			RV32EC_CYCLES( c ) += 2;
+		}
+		break;
+	}
+	case 0x03: // loads
+	{
+		static const int lens[8] = { 1, 2, 4, 0, 1, 2, 0, 0 };
+		int f3 = ( ir >> 12 ) & 7;
+		if( !lens[f3] ) return RV32EC_ILLEGAL;
+		if( ( r = RV32EC_LOAD( c, rs1 + ( (int32_t)ir >> 20 ), lens[f3], &v ) ) ) return r;
+		RV32EC_CYCLES( c )++;
+		if( f3 == 0 ) v = (int8_t)v;
+		if( f3 == 1 ) v = (int16_t)v;
+		break;
+	}
+	case 0x23: // stores
+	{
+		int f3 = ( ir >> 12 ) & 7;
+		if( f3 > 2 ) return RV32EC_ILLEGAL;
+		if( ( r = RV32EC_STORE( c, rs1 + ( ( (int32_t)ir >> 25 ) << 5 ) + ( ( ir >> 7 ) & 0x1f ), 1 << f3, rs2 ) ) ) return r;
+		RV32EC_CYCLES( c )++;
+		break;
+	}
+	case 0x13: // immediate ops
+	case 0x33: // register ops
+	{
+		int is_imm = op == 0x13;
+		uint32_t b = is_imm ? (uint32_t)( (int32_t)ir >> 20 ) : rs2;
+		if( !is_imm && ( ir >> 25 ) & ~0x20 ) return RV32EC_ILLEGAL; // No M extension
+		switch( ( ir >> 12 ) & 7 )
+		{
+		case 0: v = ( !is_imm && ( ir & 0x40000000 ) ) ? rs1 - b : rs1 + b; break;
+		case 1: v = rs1 << ( b & 0x1f ); break;
+		case 2: v = (int32_t)rs1 < (int32_t)b; break;
+		case 3: v = rs1 < b; break;
+		case 4: v = rs1 ^ b; break;
+		case 5: v = ( ir & 0x40000000 ) ? (uint32_t)( (int32_t)rs1 >> ( b & 0x1f ) ) : rs1 >> ( b & 0x1f ); break;
+		case 6: v = rs1 | b; break;
+		default: v = rs1 & b; break;
+		}
+		break;
+	}
+	case 0x0f: // fence
+		break;
+	case 0x73: // system
+		if( ( r = RV32EC_SYSTEM( c, ir, &next, &v ) ) ) return r;
+		break;
+	default:
+		return RV32EC_ILLEGAL;
+	}
+	if( uses_rd && rd ) RV32EC_REG( c, rd ) = v;
+	RV32EC_PC( c ) = next;
+	return 0;
+}
+
+#endif
@@ -0,0 +1,23 @@
+// Generated by tools/cie_gen.c -- do not edit.
+// Regenerate with: make cie_tables.c
+
+#include "cie_tables.h"
+
+const uint16_t CIE[CIE_LEN] = {
+	    0,     7,    14,    21,    28,    36,    43,    50,    57,    64,    71,    78,    85,    92,    99,   107,
+	  114,   121,   128,   135,   142,   149,   157,   164,   172,   180,   189,   197,   206,   215,   224,   234,
+	  244,   254,   265,   275,   286,   298,   309,   321,   334,   346,   359,   372,   386,   399,   414,   428,
+	  443,   458,   473,   489,   505,   522,   539,   556,   574,   592,   610,   629,   648,   667,   687,   707,
+	  728,   749,   770,   792,   814,   837,   860,   884,   908,   932,   957,   982,  1008,  1034,  1060,  1087,
+	 1115,  1143,  1171,  1200,  1229,  1259,  1289,  1320,  1351,  1383,  1415,  1448,  1481,  1515,  1549,  1584,
+	 1619,  1655,  1691,  1728,  1765,  1803,  1842,  1881,  1920,  1960,  2001,  2042,  2084,  2126,  2169,  2212,
+	 2256,  2301,  2346,  2392,  2438,  2485,  2533,  2581,  2629,  2679,  2729,  2779,  2831,  2882,  2935,  2988,
+	 3042,  3096,  3151,  3207,  3263,  3320,  3378,  3436,  3495,  3555,  3615,  3676,  3738,  3800,  3863,  3927,
+	 3991,  4056,  4122,  4189,  4256,  4324,  4393,  4462,  4532,  4603,  4675,  4747,  4820,  4894,  4969,  5044,
+	 5120,  5197,  5275,  5353,  5432,  5512,  5593,  5675,  5757,  5840,  5924,  6009,  6094,  6181,  6268,  6356,
+	 6444,  6534,  6624,  6716,  6808,  6901,  6994,  7089,  7184,  7281,  7378,  7476,  7575,  7675,  7775,  7877,
+	 7979,  8082,  8186,  8291,  8397,  8504,  8612,  8721,  8830,  8941,  9052,  9164,  9278,  9392,  9507,  9623,
+	 9740,  9858,  9977, 10096, 10217, 10339, 10462, 10585, 10710, 10836, 10962, 11090, 11218, 11348, 11478, 11610,
+	11742, 11876, 12010, 12146, 12283, 12420, 12559, 12698, 12839, 12981, 13124, 13267, 13412, 13558, 13705, 13853,
+	14002, 14152, 14303, 14456, 14609, 14763, 14919, 15076, 15233, 15392, 15552, 15713, 15875, 16038, 16203, 16368,
+};
@@ -0,0 +1,14 @@
+// Generated by tools/cie_gen.c -- do not edit.
+// Regenerate with: make cie_tables.h
+
+#ifndef _CIE_TABLES_H
+#define _CIE_TABLES_H
+
+#include <stdint.h>
+
+// 256 entries, 0 to 16368 (10 bits + 4 dither bits)
+#define CIE_LEN 256
+#define CIE_MAX 16368
+extern const uint16_t CIE[CIE_LEN];
+
+#endif
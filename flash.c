@@ -0,0 +1,41 @@
+/*
+ * Flash page erase and program, see flash.h. Each call waits for the flash
+ * controller, a page erase or program takes a few ms.
+ */
+
+#include "ch32v003fun.h"
+#include "flash.h"
+
+void flash_unlock() {
+	FLASH->KEYR = FLASH_KEY1;
+	FLASH->KEYR = FLASH_KEY2;
+	FLASH->MODEKEYR = FLASH_KEY1;
+	FLASH->MODEKEYR = FLASH_KEY2;
+}
+
+void flash_lock() {
+	FLASH->CTLR = CR_LOCK_Set;
+}
+
+void flash_erase_page(uint32_t addr) {
+	FLASH->CTLR = CR_PAGE_ER;
+	FLASH->ADDR = addr;
+	FLASH->CTLR = CR_STRT_Set | CR_PAGE_ER;
+	while (FLASH->STATR & FLASH_STATR_BSY);
+}
+
+void flash_write_page(uint32_t addr, const uint32_t * buf) {
+	volatile uint32_t * ptr = (volatile uint32_t *)addr;
+	uint8_t w;
+	FLASH->CTLR = CR_PAGE_PG;
+	FLASH->CTLR = CR_BUF_RST | CR_PAGE_PG;
+	FLASH->ADDR = addr;
+	while (FLASH->STATR & FLASH_STATR_BSY);
+	for (w = 0; w < FLASH_PAGE_WORDS; w++) {
+		ptr[w] = buf[w];
+		FLASH->CTLR = CR_PAGE_PG | CR_BUF_LOAD;
+		while (FLASH->STATR & FLASH_STATR_BSY);
+	}
+	FLASH->CTLR = CR_PAGE_PG | CR_STRT_Set;
+	while (FLASH->STATR & FLASH_STATR_BSY);
+}
@@ -0,0 +1,24 @@
+#ifndef _FLASH_H
+#define _FLASH_H
+
+// 64-byte page erase and program on the CH32V003's own flash, for the
+// settings log (settings.c) and uploaded styles (upload.c). Addresses are in
+// the 0x08000000 mapping, use FLASH_ADDR() on a pointer into flash.
+
+#include <stdint.h>
+
+#define FLASH_PAGE_BYTES 64
+#define FLASH_PAGE_WORDS (FLASH_PAGE_BYTES / 4)
+#define FLASH_ADDR(ptr) (((uint32_t)(ptr)) | 0x08000000)
+
+// Call before erasing or programming, and flash_lock() when done
+void flash_unlock();
+void flash_lock();
+
+void flash_erase_page(uint32_t addr);
+
+// One 64-byte page program. Words left at 0xffffffff in buf don't change what
+// is already in flash, so this can append to a page that has data in it.
+void flash_write_page(uint32_t addr, const uint32_t * buf);
+
+#endif
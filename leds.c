@@ -0,0 +1,104 @@
+/*
+ * LED outputs, see leds.h.
+ */
+
+#include "ch32v003fun.h"
+#include "patterns.h"
+#include "leds.h"
+
+const uint8_t led_map[NUM_LEDS] = {LED_MAP};
+
+_Static_assert(sizeof((uint8_t[]){LED_MAP}) == NUM_LEDS, "LED_MAP needs one channel per LED");
+
+static GPIO_TypeDef * const channel_port[LED_NUM_CHANNELS] = {GPIOD, GPIOA, GPIOC, GPIOC, GPIOD, GPIOD, GPIOC, GPIOD};
+static const uint8_t channel_pin[LED_NUM_CHANNELS] = {2, 1, 3, 4, 4, 3, 0, 7};
+
+// Compare values for every channel, dark unless an LED is mapped there
+static uint16_t frame[LED_NUM_CHANNELS];
+static uint8_t use_tim2;
+
+void leds_init() {
+	uint8_t l, c;
+
+	for (c = 0; c < LED_NUM_CHANNELS; c++) {
+		frame[c] = MAX_PWM_VAL;
+	}
+	for (l = 0; l < NUM_LEDS; l++) {
+		c = led_map[l];
+		use_tim2 |= c >= 4;
+		// 2MHz Output alt func, push-pull
+		channel_port[c]->CFGLR &= ~(0xf << (4 * channel_pin[c]));
+		channel_port[c]->CFGLR |= (GPIO_Speed_2MHz | GPIO_CNF_OUT_PP_AF) << (4 * channel_pin[c]);
+		// Enable the output, positive pol. CCxE and CCxP are 4 bits apart.
+		if (c < 4) {
+			TIM1->CCER |= (TIM_CC1E | TIM_CC1P) << (4 * c);
+		} else {
+			TIM2->CCER |= (TIM_CC1E | TIM_CC1P) << (4 * (c - 4));
+		}
+	}
+
+	if (use_tim2) {
+		// The same one-pulse as TIM1 (see aemhead_init() in tim1_pwm.c)
+		RCC->APB1PCENR |= RCC_APB1Periph_TIM2;
+		RCC->APB1PRSTR |= RCC_APB1Periph_TIM2;
+		RCC->APB1PRSTR &= ~RCC_APB1Periph_TIM2;
+		TIM2->PSC = TIM1->PSC;
+		TIM2->ATRLR = MAX_PWM_VAL - 1;
+		TIM2->CTLR1 |= TIM_OPM;
+		TIM2->CHCTLR1 |= TIM_OC1M_0 | TIM_OC1M_1 | TIM_OC2M_0 | TIM_OC2M_1;
+		TIM2->CHCTLR2 |= TIM_OC3M_0 | TIM_OC3M_1 | TIM_OC4M_0 | TIM_OC4M_1;
+		TIM2->CH1CVR = MAX_PWM_VAL;
+		TIM2->CH2CVR = MAX_PWM_VAL;
+		TIM2->CH3CVR = MAX_PWM_VAL;
+		TIM2->CH4CVR = MAX_PWM_VAL;
+	}
+}
+
+void leds_write(const uint16_t * vals) {
+	volatile uint32_t * cvr;
+	uint8_t l;
+
+	// The output goes high at the compare, so the count is from the end
+	for (l = 0; l < NUM_LEDS; l++) {
+		frame[led_map[l]] = MAX_PWM_VAL - vals[l];
+	}
+	// CH1CVR to CH4CVR are next to each other
+	cvr = &TIM1->CH1CVR;
+	cvr[0] = frame[0];
+	cvr[1] = frame[1];
+	cvr[2] = frame[2];
+	cvr[3] = frame[3];
+	if (use_tim2) {
+		cvr = &TIM2->CH1CVR;
+		cvr[0] = frame[4];
+		cvr[1] = frame[5];
+		cvr[2] = frame[6];
+		cvr[3] = frame[7];
+	}
+}
+
+void leds_dma_frame(uint16_t * cvr, const uint16_t * vals) {
+	uint8_t l;
+	cvr[0] = cvr[1] = cvr[2] = cvr[3] = 0;
+	for (l = 0; l < NUM_LEDS; l++) {
+		if (led_map[l] < 4) {
+			cvr[led_map[l]] = vals[l];
+		}
+	}
+}
+
+void leds_start() {
+	// TIM2 first, so TIM1 ends last and its update interrupt (see
+	// wait_for_pulse()) means both are done
+	if (use_tim2) {
+		TIM2->CTLR1 |= TIM_CEN;
+	}
+	TIM1->CTLR1 |= TIM_CEN;
+}
+
+void leds_set_prescaler(uint16_t psc) {
+	TIM1->PSC = psc;
+	if (use_tim2) {
+		TIM2->PSC = psc;
+	}
+}
@@ -0,0 +1,52 @@
+#ifndef _LEDS_H
+#define _LEDS_H
+
+// Which timer output drives each LED. LED_MAP lists a channel per LED, in
+// next_pwm_vals[] order, out of the four channels of TIM1 and the four of
+// TIM2. A badge with more LEDs only needs a longer LED_MAP (and NUM_LEDS in
+// patterns.h to match), the per-pulse cost stays the same: the compare values
+// are gathered into one frame and every timer in use gets all four written in
+// one go, with no per-LED branching.
+//
+// Both timers run the same one-pulse, so LEDs on either look the same.
+// DMA_PLAYBACK in tim1_pwm.c only streams to TIM1, so it leaves TIM2's LEDs
+// dark.
+
+#include <stdint.h>
+#include "patterns.h"
+
+// Channel numbers, timer * 4 + channel - 1. Pins are the default mapping.
+#define LED_TIM1_CH1 0 // PD2
+#define LED_TIM1_CH2 1 // PA1
+#define LED_TIM1_CH3 2 // PC3
+#define LED_TIM1_CH4 3 // PC4
+#define LED_TIM2_CH1 4 // PD4
+#define LED_TIM2_CH2 5 // PD3
+#define LED_TIM2_CH3 6 // PC0
+#define LED_TIM2_CH4 7 // PD7, also NRST, which has to be turned off first
+#define LED_NUM_CHANNELS 8
+
+#ifndef LED_MAP
+#define LED_MAP LED_TIM1_CH1, LED_TIM1_CH3, LED_TIM1_CH4
+#endif
+
+extern const uint8_t led_map[NUM_LEDS];
+
+// Set up the pins and turn on the channels in LED_MAP, and all of TIM2 if it
+// has any. TIM1 must be set up already, with its clock on.
+void leds_init();
+
+// Load PWM counts (0 to MAX_PWM_VAL, one per LED) for the next pulse
+void leds_write(const uint16_t * vals);
+
+// Start the pulse on every timer in use
+void leds_start();
+
+// Fill in one DMA_PLAYBACK frame, CH1CVR to CH4CVR of TIM1. The timer runs in
+// PWM mode 1 there, so the counts go in as they are.
+void leds_dma_frame(uint16_t * cvr, const uint16_t * vals);
+
+// Set the prescaler of every timer in use, from the next pulse on
+void leds_set_prescaler(uint16_t psc);
+
+#endif
@@ -0,0 +1,131 @@
+// Generated by tools/pattern_compiler.c from patterns.c -- do not edit.
+// Regenerate with: make pattern_tables.c
+
+#include "patterns.h"
+
+// LEDBeats LED 0: 70 wakes = 1 period(s) of 1190 ms
+static const uint16_t LEDBeats_0[70] = {
+	16368, 14456, 12146, 10585, 8721, 7089, 6009, 4747, 3676, 2988, 2212, 1584, 1200,  792,  489,  321,
+	 164,   50,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,
+};
+
+// LEDBeats LED 1: 492 wakes = 7 period(s) of 1195 ms
+static const uint16_t LEDBeats_1[492] = {
+	16368, 14456, 12146, 10585, 8721, 7089, 6009, 4747, 3676, 2988, 2212, 1584, 1200,  792,  556,  321,
+	 164,   78,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0, 15076, 12698, 11090, 9164, 7476, 6356, 5044, 3927, 3207,
+	2392, 1881, 1320,  884,  629,  372,  197,  107,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0, 15713, 13267, 11610,
+	9623, 8291, 6716, 5353, 4462, 3436, 2581, 2042, 1448,  982,  707,  428,  234,  135,   21,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0, 16368, 14456, 12146, 10096, 8721, 7089, 5675, 4747, 3676, 2779, 2212, 1584, 1200,
+	 792,  489,  321,  164,   50,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0, 15076, 12698, 10585, 9164, 7476, 6009,
+	5044, 3927, 3207, 2392, 1728, 1320,  884,  556,  372,  197,   78,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	15713, 13267, 11610, 9623, 7877, 6716, 5353, 4189, 3436, 2581, 1881, 1448,  982,  629,  428,  234,
+	 135,   21,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0, 16368, 13853, 12146, 10096, 8291, 7089, 5675, 4462, 3676, 2779,
+	2212, 1584, 1087,  792,  489,  275,  164,   50,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+};
+
+// LEDBeats LED 2: 353 wakes = 5 period(s) of 1200 ms
+static const uint16_t LEDBeats_2[353] = {
+	16368, 14456, 12146, 10585, 8721, 7089, 6009, 4747, 3676, 2988, 2212, 1728, 1200,  792,  556,  321,
+	 164,   78,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0, 15713, 13267, 11610, 9623, 8291, 6716, 5353, 4462, 3436,
+	2581, 2042, 1448,  982,  707,  428,  275,  135,   21,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0, 15076, 12698,
+	10585, 9164, 7476, 6009, 5044, 3927, 3207, 2392, 1728, 1320,  884,  556,  372,  197,   78,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0, 16368, 13853, 11610, 10096, 8291, 7089, 5675, 4462, 3676, 2779, 2042, 1584,
+	1087,  792,  489,  275,  164,   50,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0, 15076, 13267, 11090, 9164, 7877,
+	6356, 5044, 4189, 3207, 2581, 1881, 1320,  982,  629,  372,  234,  107,   21,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,
+};
+
+const struct baked_style baked_LEDBeats = {
+	{ LEDBeats_0, LEDBeats_1, LEDBeats_2 },
+	{ 70, 492, 353 },
+};
+
+uint8_t LEDBeats_baked() { return play_baked( &baked_LEDBeats ); }
+
+// Breathe LED 0: 588 wakes = 1 period(s) of 10000 ms
+static const uint16_t Breathe_0[588] = {
+	   0,    0,    0,   14,   14,   36,   36,   57,   57,   57,   78,   78,   99,   99,  121,  121,
+	 121,  142,  142,  164,  164,  189,  189,  215,  215,  215,  244,  244,  275,  275,  309,  309,
+	 309,  346,  346,  386,  386,  428,  428,  428,  473,  473,  522,  522,  574,  574,  629,  629,
+	 629,  687,  687,  749,  749,  814,  814,  814,  884,  884,  957,  957, 1034, 1034, 1034, 1115,
+	1115, 1200, 1200, 1289, 1289, 1383, 1383, 1383, 1481, 1481, 1584, 1584, 1691, 1691, 1691, 1803,
+	1803, 1920, 1920, 2042, 2042, 2042, 2169, 2169, 2301, 2301, 2438, 2438, 2581, 2581, 2581, 2729,
+	2729, 2882, 2882, 3042, 3042, 3042, 3207, 3207, 3378, 3378, 3555, 3555, 3738, 3738, 3738, 3927,
+	3927, 4122, 4122, 4324, 4324, 4324, 4532, 4532, 4747, 4747, 4969, 4969, 4969, 5197, 5197, 5432,
+	5432, 5675, 5675, 5924, 5924, 5924, 6181, 6181, 6444, 6444, 6716, 6716, 6716, 6994, 6994, 7281,
+	7281, 7575, 7575, 7575, 7877, 7877, 8186, 8186, 8504, 8504, 8830, 8830, 8830, 9164, 9164, 9507,
+	9507, 9858, 9858, 9858, 10217, 10217, 10585, 10585, 10962, 10962, 10962, 11348, 11348, 11742, 11742, 12146,
+	12146, 12559, 12559, 12559, 12981, 12981, 13412, 13412, 13853, 13853, 13853, 14303, 14303, 14763, 14763, 15233,
+	15233, 15233, 15713, 15713, 16203, 16203, 16038, 16038, 15552, 15552, 15552, 15076, 15076, 14609, 14609, 14152,
+	14152, 14152, 13705, 13705, 13267, 13267, 12839, 12839, 12420, 12420, 12420, 12010, 12010, 11610, 11610, 11218,
+	11218, 11218, 10836, 10836, 10462, 10462, 10096, 10096, 10096, 9740, 9740, 9392, 9392, 9052, 9052, 8721,
+	8721, 8721, 8397, 8397, 8082, 8082, 7775, 7775, 7775, 7476, 7476, 7184, 7184, 6901, 6901, 6901,
+	6624, 6624, 6356, 6356, 6094, 6094, 5840, 5840, 5840, 5593, 5593, 5353, 5353, 5120, 5120, 5120,
+	4894, 4894, 4675, 4675, 4462, 4462, 4462, 4256, 4256, 4056, 4056, 3863, 3863, 3676, 3676, 3676,
+	3495, 3495, 3320, 3320, 3151, 3151, 3151, 2988, 2988, 2831, 2831, 2679, 2679, 2679, 2533, 2533,
+	2392, 2392, 2256, 2256, 2126, 2126, 2126, 2001, 2001, 1881, 1881, 1765, 1765, 1765, 1655, 1655,
+	1549, 1549, 1448, 1448, 1351, 1351, 1351, 1259, 1259, 1171, 1171, 1087, 1087, 1087, 1008, 1008,
+	 932,  932,  860,  860,  860,  792,  792,  728,  728,  667,  667,  610,  610,  610,  556,  556,
+	 505,  505,  458,  458,  458,  414,  414,  372,  372,  334,  334,  334,  298,  298,  265,  265,
+	 234,  234,  206,  206,  206,  180,  180,  157,  157,  135,  135,  135,  114,  114,   92,   92,
+	  71,   71,   71,   50,   50,   28,   28,    7,    7,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+	   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+};
+
+const struct baked_style baked_Breathe = {
+	{ Breathe_0, Breathe_0, Breathe_0 },
+	{ 588, 588, 588 },
+};
+
+uint8_t Breathe_baked() { return play_baked( &baked_Breathe ); }
+
@@ -0,0 +1,280 @@
+/*
+ * LED patterns for the badge. Each style fills in next_pwm_vals[] for the
+ * next pulse, and is called once per wake from the main loop in tim1_pwm.c.
+ */
+
+#include "ch32v003fun.h"
+#include "patterns.h"
+
+static uint8_t i = 0;
+
+long map(long x, long in_min, long in_max, long out_min, long out_max) {
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+uint16_t next_pwm_vals[NUM_LEDS] = {0};
+
+// Temporal dithering. Each pulse gets the top bits of next_pwm_vals[] and the
+// leftover DITHER_BITS are carried over to the next pulse, so the LED sits
+// between two PWM counts in the right proportion. One byte of state per LED.
+uint8_t dither_error[NUM_LEDS] = {0};
+
+void dither_pwm_vals( uint16_t * out ) {
+	uint16_t v;
+	for (i = 0; i < NUM_LEDS; i++) {
+		v = next_pwm_vals[i] + dither_error[i];
+		dither_error[i] = v & ((1 << DITHER_BITS) - 1);
+		out[i] = v >> DITHER_BITS;
+	}
+}
+
+uint16_t baked_frame[NUM_LEDS] = {0};
+uint32_t phase[NUM_LEDS] = {0};
+
+// Where between two frames of the tables we are, in 1/65536 of a frame
+uint16_t baked_frac = 0;
+
+uint8_t max_sleep_wakes = MAX_SLEEP_WAKES;
+uint32_t wake_scale = WAKE_SCALE_ONE;
+
+uint8_t play_baked( const struct baked_style * s ) {
+	uint16_t f[NUM_LEDS];
+	uint16_t ahead = 0;        // Frames checked for being dark, all LEDs
+	uint16_t first_lit = 0xffff; // First lit frame found after this one
+	uint16_t frames;
+	uint32_t acc;
+	uint8_t wakes, lit = 0;
+
+	for (i = 0; i < NUM_LEDS; i++) {
+		f[i] = baked_frame[i];
+		next_pwm_vals[i] = s->table[i][f[i]];
+		lit |= next_pwm_vals[i] != 0;
+	}
+	// Each wake moves wake_scale through the tables, usually one frame. This
+	// frame is only shown after the sleep, so sleep only when it's dark, and
+	// then through the wakes that would land on dark frames too.
+	acc = baked_frac + wake_scale;
+	for (wakes = 1; !lit && wakes < max_sleep_wakes; wakes++) {
+		frames = acc >> 16;
+		while (ahead < frames && first_lit == 0xffff) {
+			ahead++;
+			for (i = 0; i < NUM_LEDS; i++) {
+				if (++f[i] == s->length[i]) {
+					f[i] = 0;
+				}
+				if (s->table[i][f[i]] != 0) {
+					first_lit = ahead;
+				}
+			}
+		}
+		if (frames >= first_lit) {
+			break;
+		}
+		acc += wake_scale;
+	}
+	frames = acc >> 16;
+	baked_frac = acc;
+	for (i = 0; i < NUM_LEDS; i++) {
+		for (ahead = 0; ahead < frames; ahead++) {
+			if (++baked_frame[i] == s->length[i]) {
+				baked_frame[i] = 0;
+			}
+		}
+	}
+	return wakes;
+}
+
+void reset_patterns() {
+	for (i = 0; i < NUM_LEDS; i++) {
+		baked_frame[i] = 0;
+		phase[i] = 0;
+	}
+	baked_frac = 0;
+}
+
+// Phase accumulator engine. Each LED has a 32-bit phase that wraps once per
+// period. It is advanced by a constant every wake, and the top 8 bits pick the
+// brightness out of a 256-entry waveform, so there are no divides at runtime.
+// The increments are worked out by the compiler.
+#define PHASE_INC(period_ms) ((uint32_t)(4294967296.0 * DEEP_SLEEP_TIME_MS / (period_ms)))
+
+// The increments of the style playing, times wake_scale. Only worked out
+// again when the style or wake_scale changes.
+const uint32_t * scaled_from = 0;
+uint32_t scaled_for = 0;
+uint32_t scaled_increment[NUM_LEDS];
+
+static void scale_increments( const uint32_t * increment ) {
+	uint64_t inc, acc;
+	uint32_t scale;
+	for (i = 0; i < NUM_LEDS; i++) {
+		// Shift and add, a multiply would pull in libgcc
+		inc = increment[i];
+		acc = 0;
+		for (scale = wake_scale; scale; scale >>= 1) {
+			if (scale & 1) {
+				acc += inc;
+			}
+			inc <<= 1;
+		}
+		scaled_increment[i] = acc >> 16;
+	}
+	scaled_from = increment;
+	scaled_for = wake_scale;
+}
+
+uint8_t play_wave( const uint8_t * wave, const uint32_t * increment ) {
+	uint8_t wakes = max_sleep_wakes;
+	uint8_t n;
+	uint32_t p;
+	if (increment != scaled_from || wake_scale != scaled_for) {
+		scale_increments(increment);
+	}
+	increment = scaled_increment;
+	for (i = 0; i < NUM_LEDS; i++) {
+		// Map "linear" to logarithmic value to match human vision
+		next_pwm_vals[i] = CIE[wave[phase[i] >> 24]];
+		// This value is shown after the sleep, so a lit LED can't sleep.
+		// A dark one counts the dark wakes coming up.
+		if (next_pwm_vals[i] != 0) {
+			wakes = 1;
+		}
+		p = phase[i];
+		for (n = 1; n < wakes; n++) {
+			p += increment[i];
+			if (CIE[wave[p >> 24]] != 0) {
+				break;
+			}
+		}
+		wakes = n;
+	}
+	// Repeated adds, a multiply would pull in libgcc
+	for (i = 0; i < NUM_LEDS; i++) {
+		for (n = 0; n < wakes; n++) {
+			phase[i] += increment[i];
+		}
+	}
+	return wakes;
+}
+
+// Bright at the start of the beat, fading to dark over the first quarter
+const uint8_t beat_wave[256] = {
+	255, 251, 247, 243, 239, 235, 231, 227, 223, 219, 215, 211, 207, 203, 199, 195,
+	191, 187, 183, 179, 175, 171, 167, 163, 159, 155, 151, 147, 143, 139, 135, 131,
+	127, 123, 119, 115, 111, 107, 103,  99,  95,  91,  87,  83,  79,  75,  71,  67,
+	 63,  59,  55,  51,  47,  43,  39,  35,  31,  27,  23,  19,  15,  11,   7,   3,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+};
+
+// The last LED beats at 50 bpm, each one before it 0.2 bpm faster
+#define BEAT_PERIOD_MS(led) (60000 / (50 + 0.2 * (NUM_LEDS - 1 - (led))))
+#define BEAT_INC(led) PHASE_INC(BEAT_PERIOD_MS(led))
+const uint32_t led_pulse_increments[NUM_LEDS] = {PER_LED(BEAT_INC)};
+
+uint8_t LEDBeats() {
+	return play_wave(beat_wave, led_pulse_increments);
+}
+
+// Breathe in for a third, out for a third, then stay dark for a third
+const uint8_t breath_wave[256] = {
+	  0,   2,   5,   8,  11,  14,  17,  20,  23,  26,  29,  32,  35,  38,  41,  44,
+	 47,  50,  53,  56,  59,  62,  65,  68,  71,  74,  77,  80,  83,  86,  89,  92,
+	 95,  98, 101, 104, 107, 110, 113, 116, 119, 122, 125, 128, 131, 134, 137, 140,
+	143, 146, 149, 152, 155, 158, 161, 164, 167, 170, 173, 176, 179, 182, 185, 188,
+	191, 194, 197, 200, 203, 206, 209, 212, 215, 218, 221, 224, 227, 230, 233, 236,
+	239, 242, 245, 248, 251, 254, 253, 250, 247, 244, 241, 238, 235, 232, 229, 226,
+	223, 220, 217, 214, 211, 208, 205, 202, 199, 196, 193, 190, 187, 184, 181, 178,
+	175, 172, 169, 166, 163, 160, 157, 154, 151, 148, 145, 142, 139, 136, 133, 130,
+	127, 124, 121, 118, 115, 112, 109, 106, 103, 100,  97,  94,  91,  88,  85,  82,
+	 79,  76,  73,  70,  67,  64,  61,  58,  55,  52,  49,  46,  43,  40,  37,  34,
+	 31,  28,  25,  22,  19,  16,  13,  10,   7,   4,   1,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+};
+
+#define BREATH_INC(led) PHASE_INC(10*1000)
+const uint32_t breath_increments[NUM_LEDS] = {PER_LED(BREATH_INC)};
+
+uint8_t Breathe() {
+	return play_wave(breath_wave, breath_increments);
+}
+
+// Original millis() based versions. These divide on every wake (and map()
+// divides again), which is slow with no hardware divider. Kept as the
+// reference the faster versions are checked and profiled against. They never
+// skip wakes.
+const long ms_in_minute = 60000;
+const long led_pulse_periods_ms[NUM_LEDS] = {PER_LED(BEAT_PERIOD_MS)};
+
+uint8_t LEDBeatsMillis() {
+
+  for (i = 0; i < NUM_LEDS; i++) {
+		// Start them flashing at the same time
+    int timestamp = (millis()) % led_pulse_periods_ms[i];
+
+    int pwm_value = 0;
+
+		if (timestamp < led_pulse_periods_ms[i]/4) {
+			pwm_value = map(timestamp, 0, led_pulse_periods_ms[i]/4, 255, 0);
+		} else {
+			pwm_value = 0;
+		}
+
+		// Map "linear" to logarithmic value to match human vision
+    pwm_value = CIE[pwm_value];
+		next_pwm_vals[i] = pwm_value;
+  }
+	return 1;
+}
+
+const long breath_period_ms = 10*1000;
+uint8_t BreatheMillis() {
+	long timestamp = (millis()) % breath_period_ms;
+
+	int pwm_value = 0;
+
+	if (timestamp < breath_period_ms/3) {
+		// Breathe in
+		pwm_value = map(timestamp, 0, breath_period_ms/3, 0, 255);
+	} else if (timestamp < (2*breath_period_ms)/3) {
+		// Breathe out
+		pwm_value = map(timestamp, breath_period_ms/3, (2*breath_period_ms)/3, 255, 0);
+	} else {
+		pwm_value = 0;
+	}
+
+	// Map "linear" to logarithmic value to match human vision
+	pwm_value = CIE[pwm_value];
+
+  for (i = 0; i < NUM_LEDS; i++) {
+		next_pwm_vals[i] = pwm_value;
+  }
+	return 1;
+}
+
+/*
+long sawtooth_time_index = 0;
+const long sawtooth_offsets[NUM_LEDS] = {0, MAX_CIE_INDEX/3, (2*MAX_CIE_INDEX)/3};
+void Sawtooth() {
+	// Just change value once per flash
+	sawtooth_time_index = (sawtooth_time_index + 1) % MAX_CIE_INDEX;
+
+	for (i = 0; i < NUM_LEDS; i++) {
+		next_pwm_vals[i] = CIE[(sawtooth_time_index + sawtooth_offsets[i]) % MAX_CIE_INDEX];
+  }
+}
+*/
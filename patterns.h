@@ -0,0 +1,112 @@
+#ifndef _PATTERNS_H
+#define _PATTERNS_H
+
+// Badge LED patterns ("styles"). Kept separate from tim1_pwm.c so the same
+// source can be compiled for the badge and for the host-side tools in tools/.
+
+#include <stdint.h>
+
+#define DEEP_SLEEP_TIME_MS 17 // (really 16.8)
+
+#define MAX_PWM_VAL 1024
+
+// TIM1 prescaler. One pulse lasts (PWM_PRESCALER+1) * MAX_PWM_VAL HCLK cycles.
+#define PWM_PRESCALER 0x4
+
+// LEDs on the badge. A different count needs LED_MAP in leds.h to match, and
+// both defined for the host tools too, so the baked tables come out the same.
+#ifndef NUM_LEDS
+#define NUM_LEDS 3
+#endif
+// Chase in vm_styles.pat uses three, and leds.h has eight channels
+#if NUM_LEDS < 3 || NUM_LEDS > 8
+#error NUM_LEDS must be 3 to 8
+#endif
+
+// f(0), f(1), ... f(NUM_LEDS-1), for filling in per-LED tables
+#define PER_LED(f) PER_LED_N(NUM_LEDS, f)
+#define PER_LED_N(n, f) PER_LED_EXPAND(n, f)
+#define PER_LED_EXPAND(n, f) PER_LED_##n(f)
+#define PER_LED_3(f) f(0), f(1), f(2)
+#define PER_LED_4(f) PER_LED_3(f), f(3)
+#define PER_LED_5(f) PER_LED_4(f), f(4)
+#define PER_LED_6(f) PER_LED_5(f), f(5)
+#define PER_LED_7(f) PER_LED_6(f), f(6)
+#define PER_LED_8(f) PER_LED_7(f), f(7)
+
+// Styles work in 1/(1 << DITHER_BITS) of a PWM count, see dither_pwm_vals()
+#define DITHER_BITS 4
+#define MAX_FINE_PWM_VAL (MAX_PWM_VAL << DITHER_BITS)
+
+// CIE lightness tables, generated by tools/cie_gen.c (CIE_TABLES in the
+// Makefile). CIE[] spans 0 to MAX_FINE_PWM_VAL-(1 << DITHER_BITS).
+#include "cie_tables.h"
+#define MAX_CIE_INDEX (CIE_LEN-1)
+
+extern long millis_start;
+extern long deep_sleep_time_ms;
+// Time in milliseconds since the board was turned on
+// Compensates for startup delay and deep sleep section, where the main HSI clock
+// is not ticking!
+#define millis()  (SysTick->CNT / DELAY_MS_TIME - millis_start + deep_sleep_time_ms)
+
+// SysTick counts per ms. It runs at HCLK/8, and HCLK is the 48 MHz PLL / 16.
+#define SYSTICK_PER_MS (FUNCONF_SYSTEM_CORE_CLOCK / 16 / 8 / 1000)
+
+// Brightness of each LED for the next pulse. 0 = dark, MAX_FINE_PWM_VAL = bright
+extern uint16_t next_pwm_vals[NUM_LEDS];
+
+// Turn next_pwm_vals[] into PWM counts (0 to MAX_PWM_VAL) for this pulse,
+// dithering the extra bits over the following pulses. Call once per pulse.
+void dither_pwm_vals( uint16_t * out );
+
+// A style fills in next_pwm_vals[] and returns how many wakes
+// (DEEP_SLEEP_TIME_MS each) to sleep before calling it again. The values it
+// fills in are only shown after that sleep, so it only returns more than 1
+// when they are dark, and every LED stays dark for the wakes in between too,
+// since a lit LED needs a pulse every wake. The style has already advanced
+// itself by that many wakes when it returns. tools/skip_check.c checks this.
+typedef uint8_t (*style)(void);
+
+// The AWU window is 6 bits, one wake per count
+#define MAX_SLEEP_WAKES 64
+
+// How long a wake really is, as a fraction of DEEP_SLEEP_TIME_MS in 1/65536ths.
+// The AWU runs off the LSI, which can be far off, so the badge measures it
+// (calibrate_wakes() in tim1_pwm.c). play_wave() and play_baked() go that much
+// further through the pattern each wake, so the periods come out right.
+#define WAKE_SCALE_ONE 65536
+extern uint32_t wake_scale;
+
+// Longest a style may ask to sleep for. Set to 1 to get one call per wake,
+// like the host tools and the button handling need.
+extern uint8_t max_sleep_wakes;
+
+uint8_t LEDBeats();
+uint8_t Breathe();
+uint8_t LEDBeatsMillis();
+uint8_t BreatheMillis();
+
+// Start all patterns over from the beginning
+void reset_patterns();
+
+// A style that has been "baked" by tools/pattern_compiler.c into one table of
+// next_pwm_vals per LED, one entry per wake. Each LED loops over its own table,
+// so LEDs with slightly different periods (LEDBeats) keep drifting apart.
+struct baked_style
+{
+	const uint16_t * table[NUM_LEDS];
+	uint16_t length[NUM_LEDS];
+};
+
+// Play back one wake's worth of a baked style, skipping ahead over dark
+// stretches. No divides. Returns the wakes to sleep, like a style.
+uint8_t play_baked( const struct baked_style * s );
+
+// Generated into pattern_tables.c
+extern const struct baked_style baked_LEDBeats;
+extern const struct baked_style baked_Breathe;
+uint8_t LEDBeats_baked();
+uint8_t Breathe_baked();
+
+#endif
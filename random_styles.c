@@ -0,0 +1,100 @@
+/*
+ * Random styles, see random_styles.h. Levels are CIE[] indexes, so fades step
+ * evenly to the eye.
+ */
+
+#include "ch32v003fun.h"
+#include "patterns.h"
+#include "random_styles.h"
+
+// Any nonzero start will do, xorshift never leaves 0
+static uint32_t rng_state = 2463534242;
+
+void rng_seed(uint32_t seed) {
+	rng_state = seed ? seed : 2463534242;
+}
+
+// Marsaglia's xorshift32, period 2^32 - 1
+uint32_t rng_next() {
+	uint32_t x = rng_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	rng_state = x;
+	return x;
+}
+
+// Candle. Each LED eases a quarter of the way towards a new random target
+// every wake, so the flicker is soft. A byte of randomness per LED, plus one
+// for the gusts.
+#define CANDLE_BASE 128 // Targets run CANDLE_BASE to CANDLE_BASE + 63
+#define CANDLE_GUST 80  // How far a gust pulls the targets down
+#define CANDLE_GUST_ODDS 6 // Out of 256 wakes, about one every 3/4 second
+
+static uint8_t candle_level[NUM_LEDS];
+
+uint8_t Candle() {
+	uint32_t r = rng_next();
+	uint8_t gust = (r >> 24) < CANDLE_GUST_ODDS;
+	int16_t target;
+	uint8_t l;
+
+	for (l = 0; l < NUM_LEDS; l++) {
+		target = CANDLE_BASE + (r & 63);
+		if (gust) {
+			target -= CANDLE_GUST;
+		}
+		candle_level[l] += (target - candle_level[l]) >> 2;
+		next_pwm_vals[l] = CIE[candle_level[l]];
+		r >>= 8;
+	}
+	return 1;
+}
+
+// Sparkle. A flash starts near full brightness and fades out over about 8
+// wakes, then the LEDs stay dark for a random gap.
+#define SPARKLE_FADE 32
+#define SPARKLE_MIN_GAP 4 // Wakes, plus up to 63 more
+
+static uint8_t sparkle_level[NUM_LEDS];
+static uint8_t sparkle_led;
+static uint8_t sparkle_gap;
+
+uint8_t Sparkle() {
+	uint8_t l, lit = 0, wakes;
+	uint32_t r;
+
+	if (sparkle_gap) {
+		wakes = (sparkle_gap < max_sleep_wakes) ? sparkle_gap : max_sleep_wakes;
+		sparkle_gap -= wakes;
+		for (l = 0; l < NUM_LEDS; l++) {
+			next_pwm_vals[l] = 0;
+		}
+		return wakes;
+	}
+
+	for (l = 0; l < NUM_LEDS; l++) {
+		lit |= sparkle_level[l];
+	}
+	if (!lit) {
+		// Hop one or two LEDs along, so the same one never flashes twice
+		// running. No modulo needed.
+		r = rng_next();
+		sparkle_led += 1 + (r & 1);
+		if (sparkle_led >= NUM_LEDS) {
+			sparkle_led -= NUM_LEDS;
+		}
+		sparkle_level[sparkle_led] = MAX_CIE_INDEX - ((r >> 1) & 63);
+	}
+
+	lit = 0;
+	for (l = 0; l < NUM_LEDS; l++) {
+		next_pwm_vals[l] = CIE[sparkle_level[l]];
+		sparkle_level[l] = (sparkle_level[l] > SPARKLE_FADE) ? sparkle_level[l] - SPARKLE_FADE : 0;
+		lit |= sparkle_level[l];
+	}
+	if (!lit) {
+		sparkle_gap = SPARKLE_MIN_GAP + (rng_next() & 63);
+	}
+	return 1;
+}
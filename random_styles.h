@@ -0,0 +1,25 @@
+#ifndef _RANDOM_STYLES_H
+#define _RANDOM_STYLES_H
+
+// Styles that never repeat, driven by a xorshift PRNG. Shifts, xors and adds
+// only, so a wake costs a few dozen cycles and no libgcc.
+
+#include <stdint.h>
+
+// Seed from something that differs between power ups, the badge uses ADC
+// noise (seed_random() in tim1_pwm.c). Without a seed the sequence is fixed,
+// which is what the host tools want.
+void rng_seed(uint32_t seed);
+
+// Next 32 random bits
+uint32_t rng_next();
+
+// Flickers around a warm middle brightness, with the odd gust dimming all
+// the LEDs at once. Lit every wake.
+uint8_t Candle();
+
+// Dark, with a brief flash on one LED at a time at random intervals. Sleeps
+// through the gaps.
+uint8_t Sparkle();
+
+#endif
@@ -0,0 +1,123 @@
+/*
+ * Wear-levelled settings log in flash, see settings.h.
+ *
+ * Each 64-byte page holds a header word and 15 records:
+ *   header: 0x5A in the top byte, a 24-bit sequence number below it
+ *   record: key, value low byte, value high byte, check byte
+ * The page with the highest sequence number is the current one. It starts
+ * with a copy of every setting, so it is the only page read at startup.
+ * A record or header torn by a power cut fails its check and is ignored.
+ */
+
+#include "ch32v003fun.h"
+#include "settings.h"
+#include "flash.h"
+
+#define PAGE_WORDS FLASH_PAGE_WORDS
+#define HEADER_MAGIC 0x5A000000
+#define HEADER_VALID(w) (((w) & 0xff000000) == HEADER_MAGIC)
+#define HEADER_SEQ(w) ((w) & 0x00ffffff)
+
+// The log itself. Erased (all 1s) when the badge is flashed, so flashing
+// new firmware also resets the settings.
+const uint32_t settings_log[SETTINGS_PAGES * PAGE_WORDS] __attribute__((aligned(64))) = {
+	[0 ... SETTINGS_PAGES * PAGE_WORDS - 1] = 0xffffffff
+};
+
+static uint16_t values[NUM_SETTINGS];
+static uint8_t page;      // Current page
+static uint8_t next_slot; // Next free word in it, PAGE_WORDS when full
+static uint32_t seq;
+
+static uint32_t make_record(uint8_t key, uint16_t value) {
+	uint8_t lo = value & 0xff;
+	uint8_t hi = value >> 8;
+	return key | (lo << 8) | (hi << 16) | ((uint32_t)(0xA5 ^ key ^ lo ^ hi) << 24);
+}
+
+static int record_valid(uint32_t r) {
+	return make_record(r & 0xff, r >> 8) == r && (r & 0xff) < NUM_SETTINGS;
+}
+
+#define PAGE_ADDR(p) FLASH_ADDR(&settings_log[(p) * PAGE_WORDS])
+
+// Read through a volatile pointer, the compiler thinks settings_log is all 1s
+static uint32_t log_word(uint8_t p, uint8_t w) {
+	return ((volatile const uint32_t *)settings_log)[p * PAGE_WORDS + w];
+}
+
+void settings_init(const uint16_t * defaults) {
+	uint8_t p, w, k;
+	int found = 0;
+
+	for (k = 0; k < NUM_SETTINGS; k++) {
+		values[k] = defaults[k];
+	}
+
+	for (p = 0; p < SETTINGS_PAGES; p++) {
+		uint32_t h = log_word(p, 0);
+		if (HEADER_VALID(h) && (!found || HEADER_SEQ(h) > seq)) {
+			found = 1;
+			page = p;
+			seq = HEADER_SEQ(h);
+		}
+	}
+
+	if (!found) {
+		// Never written. Start on the last page so the first rotation erases page 0.
+		page = SETTINGS_PAGES - 1;
+		next_slot = PAGE_WORDS;
+		seq = 0;
+		return;
+	}
+
+	// Replay the current page. Later records override earlier ones.
+	for (w = 1; w < PAGE_WORDS; w++) {
+		uint32_t r = log_word(page, w);
+		if (r == 0xffffffff) {
+			break;
+		}
+		if (record_valid(r)) {
+			values[r & 0xff] = r >> 8;
+		}
+	}
+	next_slot = w;
+}
+
+uint16_t settings_get(uint8_t key) {
+	return values[key];
+}
+
+void settings_set(uint8_t key, uint16_t value) {
+	uint32_t buf[PAGE_WORDS];
+	uint8_t w;
+
+	if (values[key] == value) {
+		return;
+	}
+	values[key] = value;
+
+	for (w = 0; w < PAGE_WORDS; w++) {
+		buf[w] = 0xffffffff;
+	}
+
+	flash_unlock();
+	if (next_slot < PAGE_WORDS) {
+		// Append to the current page
+		buf[next_slot++] = make_record(key, value);
+	} else {
+		// Page is full. Move to the next one with a copy of everything.
+		if (++page == SETTINGS_PAGES) {
+			page = 0;
+		}
+		seq = (seq + 1) & 0x00ffffff;
+		flash_erase_page(PAGE_ADDR(page));
+		buf[0] = HEADER_MAGIC | seq;
+		for (w = 0; w < NUM_SETTINGS; w++) {
+			buf[w + 1] = make_record(w, values[w]);
+		}
+		next_slot = NUM_SETTINGS + 1;
+	}
+	flash_write_page(PAGE_ADDR(page), buf);
+	flash_lock();
+}
@@ -0,0 +1,30 @@
+#ifndef _SETTINGS_H
+#define _SETTINGS_H
+
+// Settings that survive a power cycle, kept in a small log in flash.
+//
+// Every change appends one 4-byte record to the current 64-byte flash page (one
+// page program, no erase). When the page fills up, the next page is erased and
+// gets a fresh copy of every setting, so writes walk around all SETTINGS_PAGES
+// pages. The values live in RAM after settings_init(), so reading a setting
+// never touches flash.
+
+#include <stdint.h>
+
+#define SETTINGS_PAGES 4
+
+enum setting_key {
+	SETTING_STYLE,
+	SETTING_BRIGHTNESS,
+	NUM_SETTINGS
+};
+
+// Load the settings from flash. Anything never saved reads as its default.
+void settings_init(const uint16_t * defaults);
+
+uint16_t settings_get(uint8_t key);
+
+// Save a setting, if it changed. Takes a few ms while flash is written.
+void settings_set(uint8_t key, uint16_t value);
+
+#endif
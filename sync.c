@@ -0,0 +1,159 @@
+/*
+ * Beacons between badges, see sync.h. Everything here runs with HCLK at
+ * 3 MHz, so the bit timing is done against SysTick instead of Delay_Us().
+ */
+
+#include "ch32v003fun.h"
+#include "patterns.h"
+#include "sync.h"
+
+#define SYNC_EXTI_LINE (1 << SYNC_PIN)
+#define SYNC_BITS (2 * SYNC_INDEX_BITS)
+
+uint16_t sync_wakes = 0;
+// Wakes left of listening for a whole period
+static uint16_t sync_acquire_wakes;
+// Heard a beacon for this boundary already, so don't add ours to it
+static uint8_t sync_heard;
+
+static uint8_t sync_line() {
+	return (GPIOD->INDR >> SYNC_PIN) & 1;
+}
+
+static void sync_line_release() {
+	// Input, pulled down
+	GPIOD->CFGLR = (GPIOD->CFGLR & ~(0xf << (4 * SYNC_PIN))) | (GPIO_CNF_IN_PUPD << (4 * SYNC_PIN));
+	GPIOD->BSHR = 1 << (16 + SYNC_PIN);
+}
+
+// Only ever driven high. Low is left to the pull-downs, so badges sending at
+// the same time OR together instead of fighting over the line.
+static void sync_line_drive(uint8_t high) {
+	if (high) {
+		GPIOD->BSHR = 1 << SYNC_PIN;
+		GPIOD->CFGLR = (GPIOD->CFGLR & ~(0xf << (4 * SYNC_PIN))) | ((GPIO_Speed_2MHz | GPIO_CNF_OUT_PP) << (4 * SYNC_PIN));
+	} else {
+		sync_line_release();
+	}
+}
+
+static void sync_wait_until(uint32_t start, uint32_t ticks) {
+	while (SysTick->CNT - start < ticks);
+}
+
+void sync_init() {
+	sync_line_release();
+	AFIO->EXTICR = (AFIO->EXTICR & ~(0b11 << (2 * SYNC_PIN))) | (0b11 << (2 * SYNC_PIN));
+	EXTI->RTENR |= SYNC_EXTI_LINE;
+	sync_wakes = 0;
+	sync_acquire_wakes = SYNC_PERIOD_WAKES + SYNC_WINDOW_WAKES;
+	sync_heard = 0;
+}
+
+static void sync_send() {
+	uint8_t index = sync_wakes >> SYNC_PERIOD_SHIFT;
+	uint16_t bits = index | (~index << SYNC_INDEX_BITS);
+	uint32_t start;
+	uint8_t b;
+
+	// Don't wake ourselves up with it
+	EXTI->EVENR &= ~SYNC_EXTI_LINE;
+
+	sync_line_drive(1);
+	start = SysTick->CNT;
+	sync_wait_until(start, SYNC_START_TICKS);
+	sync_line_drive(0);
+	start = SysTick->CNT;
+	for (b = 0; b < SYNC_BITS; b++) {
+		sync_wait_until(start, SYNC_BIT_TICKS * (b + 1));
+		sync_line_drive((bits >> b) & 1);
+	}
+	sync_wait_until(start, SYNC_BIT_TICKS * (SYNC_BITS + 1));
+	sync_line_release();
+}
+
+// The epoch wake a beacon was sent at, or -1 if that was no beacon
+static int32_t sync_receive() {
+	uint32_t start = SysTick->CNT;
+	uint16_t bits = 0;
+	uint8_t b, index;
+
+	while (sync_line()) {
+		if (SysTick->CNT - start > 2 * SYNC_START_TICKS) {
+			return -1;
+		}
+	}
+	start = SysTick->CNT;
+	for (b = 0; b < SYNC_BITS; b++) {
+		// Middle of the bit, after the gap
+		sync_wait_until(start, SYNC_BIT_TICKS * (b + 1) + SYNC_BIT_TICKS / 2);
+		bits |= sync_line() << b;
+	}
+	index = bits & ((1 << SYNC_INDEX_BITS) - 1);
+	if (((bits >> SYNC_INDEX_BITS) ^ index) != (1 << SYNC_INDEX_BITS) - 1) {
+		return -1;
+	}
+	return (int32_t)index << SYNC_PERIOD_SHIFT;
+}
+
+uint8_t sync_beacon_coming() {
+	return (EXTI->EVENR & SYNC_EXTI_LINE) && sync_line();
+}
+
+uint8_t sync_wake() {
+	int32_t theirs = -1;
+	uint16_t ahead;
+	uint8_t catch_up = 0;
+
+	if (sync_beacon_coming()) {
+		theirs = sync_receive();
+	}
+	if (theirs >= 0) {
+		ahead = (theirs - sync_wakes) & (SYNC_EPOCH_WAKES - 1);
+		if (ahead != 0 && ahead < SYNC_EPOCH_WAKES / 2) {
+			if (ahead <= SYNC_WINDOW_WAKES) {
+				// Nearly there, the patterns skip ahead to match
+				catch_up = ahead;
+			}
+			// Otherwise just take their count, the patterns line up at the
+			// next epoch
+			sync_wakes = theirs;
+		}
+		// We are at a boundary they just sent a beacon for
+		sync_heard = (ahead < SYNC_EPOCH_WAKES / 2);
+	}
+
+	if ((sync_wakes & (SYNC_PERIOD_WAKES - 1)) == 0) {
+		if (!sync_heard) {
+			sync_send();
+		}
+		sync_heard = 0;
+		if (sync_wakes == 0) {
+			sync_acquire_wakes = SYNC_PERIOD_WAKES;
+		}
+	}
+	return catch_up;
+}
+
+uint8_t sync_sleep_wakes(uint8_t max) {
+	uint16_t until = SYNC_PERIOD_WAKES - (sync_wakes & (SYNC_PERIOD_WAKES - 1));
+	uint8_t window = until <= SYNC_WINDOW_WAKES;
+
+	if (window) {
+		// One wake at a time, so we know exactly when a beacon came
+		max = 1;
+	} else if (until - SYNC_WINDOW_WAKES < max) {
+		max = until - SYNC_WINDOW_WAKES;
+	}
+	if (window || sync_acquire_wakes) {
+		EXTI->EVENR |= SYNC_EXTI_LINE;
+	} else {
+		EXTI->EVENR &= ~SYNC_EXTI_LINE;
+	}
+	return max;
+}
+
+void sync_slept(uint8_t wakes) {
+	sync_wakes = (sync_wakes + wakes) & (SYNC_EPOCH_WAKES - 1);
+	sync_acquire_wakes = (sync_acquire_wakes > wakes) ? sync_acquire_wakes - wakes : 0;
+}
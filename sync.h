@@ -0,0 +1,63 @@
+#ifndef _SYNC_H
+#define _SYNC_H
+
+// Keeps the patterns of badges wired together in step (BADGE_SYNC in
+// tim1_pwm.c). Each badge runs off its own LSI, which can be a few percent
+// off, so left alone their beats drift apart within a minute.
+//
+// The badges share one line, SYNC_PIN on port D, pulled down on every badge.
+// Each badge counts wakes, and every SYNC_PERIOD_WAKES it sends a beacon: a
+// 1 ms start pulse, a low gap bit, then which period of the epoch it is in
+// (SYNC_INDEX_BITS) and the same bits inverted, at SYNC_BIT_TICKS a bit. A
+// badge only ever drives the line high and lets the pull-downs take it low,
+// so two beacons on top of each other OR together. That always breaks the
+// inverted copy, so they get thrown away.
+//
+// A badge listens (EXTI, so it can stay in standby) only for the
+// SYNC_WINDOW_WAKES wakes before its own beacon is due, waking every wake
+// meanwhile so its count is exact. A beacon heard there is from a badge that
+// is ahead, so it catches up to it. Badges that are behind catch up to it in
+// turn, and everybody ends up with the fastest badge. After power on, and at
+// the start of every epoch, it also listens for a whole period, which is how
+// a badge that is way off finds the others.
+//
+// Every SYNC_EPOCH_WAKES the patterns restart, so a badge that joined late or
+// changed style lines up with the rest from then on.
+
+#include <stdint.h>
+
+#define SYNC_PIN 6 // PD6, EXTI line 6
+
+#define SYNC_PERIOD_SHIFT 8
+#define SYNC_PERIOD_WAKES (1 << SYNC_PERIOD_SHIFT) // A beacon every 4.4 s
+#define SYNC_INDEX_BITS 5
+#define SYNC_EPOCH_WAKES (SYNC_PERIOD_WAKES << SYNC_INDEX_BITS) // 2.3 minutes
+#define SYNC_WINDOW_WAKES 16 // Room for a 6% difference between two LSIs
+
+// In SysTick counts
+#define SYNC_START_TICKS SYSTICK_PER_MS // Long enough to wake up from standby
+#define SYNC_BIT_TICKS (SYSTICK_PER_MS / 4)
+
+// Wakes into the current epoch, the same on every badge once in sync
+extern uint16_t sync_wakes;
+
+// Set up the pin and EXTI, and start listening. Call after setup_deep_sleep().
+void sync_init();
+
+// Whether a beacon is on the line, while we are listening. That is what ended
+// the sleep if it is, not the AWU.
+uint8_t sync_beacon_coming();
+
+// Call first thing after every wake, while a beacon that woke us is still
+// coming in. Sends our beacon if one is due. Returns how many wakes to skip
+// the patterns ahead by, to catch up to a badge that is a little ahead.
+uint8_t sync_wake();
+
+// Longest the coming sleep may be, given max, so we never sleep past the
+// listening window or a beacon. Also turns listening on or off for the sleep.
+uint8_t sync_sleep_wakes(uint8_t max);
+
+// Count the wakes just slept
+void sync_slept(uint8_t wakes);
+
+#endif
@@ -10,130 +10,162 @@
 	//#define HSI_VALUE          (1500000) //
 #include <stdio.h>
 #include "ch32v003_GPIO_branchless.h"
+#include "patterns.h"
+#include "settings.h"
+#include "vm.h"
+#include "upload.h"
+#include "random_styles.h"
+#include "leds.h"
 
 // Are we going to use deep sleep? If yes, leave uncommented
 #define DEEP_SLEEP
 
-#define DEEP_SLEEP_TIME_MS 17 // (really 16.8)
+// Uncomment to stay on the 24 MHz HSI after waking instead of waiting for the PLL
+// to lock again. HCLK halves, so each pulse (and the LEDs) would be on twice as
+// long unless PWM_PRESCALER is halved to match.
+//#define RESUME_ON_HSI
+
+// Uncomment to stay awake in sleep mode and let DMA stream a buffer of frames
+// into TIM1 (see extralibs/tim1_dma_pwm.h) instead of waking from standby for
+// every pulse. The core wakes once per TIM1DMAPWM_FRAMES/2 frames, but sleep
+// mode keeps the clocks running, so it still loses to standby on battery life.
+// make energy compares the two.
+//#define DMA_PLAYBACK
+
+// Uncomment to keep the patterns of badges wired together on PD6 in step, see
+// sync.h. Needs DEEP_SLEEP.
+//#define BADGE_SYNC
+
+#ifdef DMA_PLAYBACK
+#undef DEEP_SLEEP
+#define TIM1DMAPWM_IMPLEMENTATION
+#include "tim1_dma_pwm.h"
+// One frame every DEEP_SLEEP_TIME_MS, in HCLK cycles (HCLK is SYSCLK/16)
+#define DMA_FRAME_CYCLES (FUNCONF_SYSTEM_CORE_CLOCK / 16 * DEEP_SLEEP_TIME_MS / 1000)
+#endif
 
-#define MAX_PWM_VAL 1024
+#ifdef BADGE_SYNC
+#ifndef DEEP_SLEEP
+#error BADGE_SYNC listens for beacons from standby, it needs DEEP_SLEEP
+#endif
+#include "sync.h"
+#endif
 
-#define NUM_LEDS 3
 uint8_t i = 0;
 
 uint8_t button_is_pressed = 0;
-long button_started_press_ms = 0;
-long button_released_press_ms = 0;
-#define BUTTON_DEBOUNCE_DELAY_MS 20
+// Wakes since the button went down, stops counting at 255
+uint8_t button_held_wakes = 0;
+// Wakes left before the button is looked at again after it changed
+uint8_t button_debounce_wakes = 0;
+#define BUTTON_DEBOUNCE_WAKES 2 // 34 ms
+// Holding the button this long adjusts brightness instead of changing style
+#define LONG_PRESS_WAKES 30 // About half a second
+#define BRIGHTNESS_STEP_WAKES 24 // Then one step every 0.4 s while held
+
+// Brightness ladder. Holding the button steps around these TIM1 prescalers.
+// A pulse lasts (prescaler+1) * MAX_PWM_VAL cycles, so a smaller one dims
+// every LED at once without touching the styles, and gets us back to sleep
+// sooner.
+const uint8_t brightness_prescalers[] = {9, PWM_PRESCALER, 2, 1, 0};
+#define NUM_BRIGHTNESS (sizeof(brightness_prescalers) / sizeof(brightness_prescalers[0]))
+#define DEFAULT_BRIGHTNESS 1
+uint8_t brightness_index = DEFAULT_BRIGHTNESS;
+uint8_t brightness_step_wakes = 0;
 
 long millis_start = 0;
 long deep_sleep_time_ms = 0;
-// Time in milliseconds since the board was turned on
-// Compensates for startup delay and deep sleep section, where the main HSI clock
-// is not ticking!
-#define millis()  (SysTick->CNT / DELAY_MS_TIME - millis_start + deep_sleep_time_ms)
-
-// From https://gist.github.com/mathiasvr/19ce1d7b6caeab230934080ae1f1380e
-#define MAX_CIE_INDEX (256-1)
-const uint16_t CIE[MAX_CIE_INDEX+1] = {
-    0,    0,    1,    1,    2,    2,    3,    3,    4,    4,    4,    5,    5,    6,    6,    7,
-    7,    8,    8,    8,    9,    9,   10,   10,   11,   11,   12,   12,   13,   13,   14,   15,
-   15,   16,   17,   17,   18,   19,   19,   20,   21,   22,   22,   23,   24,   25,   26,   27,
-   28,   29,   30,   31,   32,   33,   34,   35,   36,   37,   38,   39,   40,   42,   43,   44,
-   45,   47,   48,   50,   51,   52,   54,   55,   57,   58,   60,   61,   63,   65,   66,   68,
-   70,   71,   73,   75,   77,   79,   81,   83,   84,   86,   88,   90,   93,   95,   97,   99,
-  101,  103,  106,  108,  110,  113,  115,  118,  120,  123,  125,  128,  130,  133,  136,  138,
-  141,  144,  147,  149,  152,  155,  158,  161,  164,  167,  171,  174,  177,  180,  183,  187,
-  190,  194,  197,  200,  204,  208,  211,  215,  218,  222,  226,  230,  234,  237,  241,  245,
-  249,  254,  258,  262,  266,  270,  275,  279,  283,  288,  292,  297,  301,  306,  311,  315,
-  320,  325,  330,  335,  340,  345,  350,  355,  360,  365,  370,  376,  381,  386,  392,  397,
-  403,  408,  414,  420,  425,  431,  437,  443,  449,  455,  461,  467,  473,  480,  486,  492,
-  499,  505,  512,  518,  525,  532,  538,  545,  552,  559,  566,  573,  580,  587,  594,  601,
-  609,  616,  624,  631,  639,  646,  654,  662,  669,  677,  685,  693,  701,  709,  717,  726,
-  734,  742,  751,  759,  768,  776,  785,  794,  802,  811,  820,  829,  838,  847,  857,  866,
-  875,  885,  894,  903,  913,  923,  932,  942,  952,  962,  972,  982,  992, 1002, 1013, 1023,
-};
 
-long map(long x, long in_min, long in_max, long out_min, long out_max) {
-  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+// Sleep for this many wakes (1 to MAX_SLEEP_WAKES) the next time we go to sleep
+void set_sleep_wakes(uint8_t wakes)
+{
+	PWR->AWUWR = (PWR->AWUWR & ~0x3f) | (wakes - 1);
 }
 
-/*
- * set timer channel PW
- */
-void t1pwm_setpw(uint8_t chl, uint16_t width)
+// Only here to wake the main loop up when a pulse is done
+void TIM1_UP_IRQHandler(void) __attribute__((interrupt));
+void TIM1_UP_IRQHandler(void)
 {
-	// Make values make sense. 0 = dark, MAX_PWM_VAL = bright
-	width = MAX_PWM_VAL - width;
-	switch(chl&3)
-	{
-		case 0: TIM1->CH1CVR = width; break;
-		case 1: TIM1->CH3CVR = width; break;
-		case 2: TIM1->CH4CVR = width; break;
-	}
+	TIM1->INTFR = ~TIM_UIF;
 }
 
-uint16_t next_pwm_vals[NUM_LEDS] = {0};
-
-const long ms_in_minute = 60000;
-const long led_pulse_periods_ms[NUM_LEDS] = {ms_in_minute/50.4, ms_in_minute/50.2, ms_in_minute/50};
-
-void LEDBeats() {
-
-  for (i = 0; i < NUM_LEDS; i++) {
-		// Start them flashing at the same time
-    int timestamp = (millis()) % led_pulse_periods_ms[i];
-
-    int pwm_value = 0;
-
-		if (timestamp < led_pulse_periods_ms[i]/4) {
-			pwm_value = map(timestamp, 0, led_pulse_periods_ms[i]/4, 255, 0);
-		} else {
-			pwm_value = 0;
-		}
-
-		// Map "linear" to logarithmic value to match human vision
-    pwm_value = CIE[pwm_value];
-		next_pwm_vals[i] = pwm_value;
-  }
+// Sleep with the clocks running until TIM1 is done with the pulse
+void wait_for_pulse()
+{
+	// Plain sleep, not standby, or TIM1 would stop too
+	PFIC->SCTLR &= ~(1 << 2);
+	// A pending interrupt still ends wfi with interrupts off, so there is no
+	// race with the pulse ending between the check and the wfi
+	__disable_irq();
+	while (TIM1->CTLR1 & TIM_CEN) {
+		__WFI();
+	}
+	__enable_irq();
+#ifdef DEEP_SLEEP
+	PFIC->SCTLR |= (1 << 2);
+#endif
 }
 
-const long breath_period_ms = 10*1000;
-void Breathe() {
-	long timestamp = (millis()) % breath_period_ms;
-
-	int pwm_value = 0;
-
-	if (timestamp < breath_period_ms/3) {
-		// Breathe in
-		pwm_value = map(timestamp, 0, breath_period_ms/3, 0, 255);
-	} else if (timestamp < (2*breath_period_ms)/3) {
-		// Breathe out
-		pwm_value = map(timestamp, breath_period_ms/3, (2*breath_period_ms)/3, 255, 0);
-	} else {
-		pwm_value = 0;
+// The AWU runs off the LSI, which can be off by tens of percent, so every so
+// often the length of a wake is measured against SysTick, which runs off the
+// far better HSI. That's done in plain sleep, at boot and then every
+// CALIBRATE_EVERY_WAKES at the start of a dark stretch, so it never costs an
+// extra wake.
+#define CALIBRATE_WAKES 2
+#define CALIBRATE_EVERY_WAKES 16384 // About 4.6 minutes
+uint16_t calibrate_wakes_left = CALIBRATE_EVERY_WAKES;
+// Length of a wake in 1/256 ms, and what didn't make it into deep_sleep_time_ms
+uint16_t wake_ms_q8 = DEEP_SLEEP_TIME_MS << 8;
+uint8_t sleep_ms_frac = 0;
+
+// Sleeps for CALIBRATE_WAKES + 1 wakes, the first to line up with the AWU
+void calibrate_wakes()
+{
+	uint32_t evenr = EXTI->EVENR;
+	uint32_t start, ticks, per_ms, scale;
+	uint8_t n;
+
+	// Only the AWU may end these sleeps
+	EXTI->EVENR = EXTI_Line9;
+	set_sleep_wakes(1);
+	PFIC->SCTLR &= ~(1 << 2);
+	__WFE();
+	start = SysTick->CNT;
+	for (n = 0; n < CALIBRATE_WAKES; n++) {
+		__WFE();
 	}
+	ticks = (SysTick->CNT - start) / CALIBRATE_WAKES;
+#ifdef DEEP_SLEEP
+	PFIC->SCTLR |= (1 << 2);
+#endif
+	EXTI->EVENR = evenr;
 
-	// Map "linear" to logarithmic value to match human vision
-	pwm_value = CIE[pwm_value];
-
-  for (i = 0; i < NUM_LEDS; i++) {
-		next_pwm_vals[i] = pwm_value;
-  }
+	// SysTick is half as fast when we're running on the HSI
+	per_ms = SYSTICK_PER_MS;
+	if ((RCC->CFGR0 & RCC_SWS) != RCC_SWS_PLL) {
+		per_ms >>= 1;
+	}
+	scale = (ticks << 16) / (per_ms * DEEP_SLEEP_TIME_MS);
+	if (scale < WAKE_SCALE_ONE / 2 || scale > WAKE_SCALE_ONE * 2) {
+		// Not a sane LSI, something else must have woken us
+		return;
+	}
+	wake_scale = scale;
+	wake_ms_q8 = (ticks << 8) / per_ms;
 }
 
-/*
-long sawtooth_time_index = 0;
-const long sawtooth_offsets[NUM_LEDS] = {0, MAX_CIE_INDEX/3, (2*MAX_CIE_INDEX)/3};
-void Sawtooth() {
-	// Just change value once per flash
-	sawtooth_time_index = (sawtooth_time_index + 1) % MAX_CIE_INDEX;
-
-	for (i = 0; i < NUM_LEDS; i++) {
-		next_pwm_vals[i] = CIE[(sawtooth_time_index + sawtooth_offsets[i]) % MAX_CIE_INDEX];
-  }
+// Count slept wakes into millis(), at their measured length
+void add_sleep_time(uint8_t wakes)
+{
+	uint32_t q8 = sleep_ms_frac;
+	// Repeated adds, a multiply would pull in libgcc
+	while (wakes--) {
+		q8 += wake_ms_q8;
+	}
+	deep_sleep_time_ms += q8 >> 8;
+	sleep_ms_frac = q8;
 }
-*/
+
 void setup_deep_sleep()
 {
 
@@ -148,12 +180,19 @@ void setup_deep_sleep()
 	EXTI->EVENR |= EXTI_Line9;
 	EXTI->FTENR |= EXTI_Line9;
 
-	// configure AWU prescaler
-	PWR->AWUPSC |= PWR_AWU_Prescaler_1024;
+	// Also wake on either edge of the button, PD0 (0b11) on EXTI line 0, so a
+	// press is seen right away even in the middle of a long sleep
+	RCC->APB2PCENR |= RCC_AFIOEN;
+	AFIO->EXTICR = (AFIO->EXTICR & ~AFIO_EXTICR_EXTI0) | (0b11 << (2*0));
+	EXTI->RTENR |= EXTI_Line0;
+	EXTI->FTENR |= EXTI_Line0;
+	EXTI->EVENR |= EXTI_Line0;
+
+	// configure AWU prescaler. 128 kHz LSI / 2048 = one count per wake
+	PWR->AWUPSC = (PWR->AWUPSC & ~0xf) | PWR_AWU_Prescaler_2048;
 
 	// configure AWU window comparison value
-	PWR->AWUWR &= ~0x3f;
-	PWR->AWUWR |= 1;
+	set_sleep_wakes(1);
 
 	// enable AWU
 	PWR->AWUCSR |= (1 << 1);
@@ -220,44 +259,46 @@ void aemhead_init( void )
 	// Set up the pin as pull down
 	GPIO_digitalWrite_lo(GPIOv_from_PORT_PIN(GPIO_port_D, 0));
 
-	// PD2 is T1CH1, 2MHz Output alt func, push-pull
-	GPIOD->CFGLR &= ~(0xf<<(4*2));
-	GPIOD->CFGLR |= (GPIO_Speed_2MHz | GPIO_CNF_OUT_PP_AF)<<(4*2);
-
-	// PC3 is T1CH3, 2MHz Output alt func, push-pull
-	GPIOC->CFGLR &= ~(0xf<<(4*3));
-	GPIOC->CFGLR |= (GPIO_Speed_2MHz | GPIO_CNF_OUT_PP_AF)<<(4*3);
-
-	// PC4 is T1CH4, 2MHz Output alt func, push-pull
-	GPIOC->CFGLR &= ~(0xf<<(4*4));
-	GPIOC->CFGLR |= (GPIO_Speed_2MHz | GPIO_CNF_OUT_PP_AF)<<(4*4);
-
+	// The LED pins are set up by leds_init(), below
 
 	// Reset TIM1 to init all regs
 	RCC->APB2PRSTR |= RCC_APB2Periph_TIM1;
 	RCC->APB2PRSTR &= ~RCC_APB2Periph_TIM1;
 
 	// Prescaler
-	TIM1->PSC = 0x4;
+	TIM1->PSC = PWM_PRESCALER;
 
+#ifdef DMA_PLAYBACK
+	// Auto Reload - one whole frame, the LEDs are lit for the first CVR counts
+	TIM1->ATRLR = DMA_FRAME_CYCLES / (PWM_PRESCALER+1) - 1;
+#else
 	// Auto Reload - sets period
 	TIM1->ATRLR = MAX_PWM_VAL-1; // So off is actually off apparently
 
 	// One pulse mode (pulse and then stop)
 	TIM1->CTLR1 |= TIM_OPM;
+#endif
 
-	// Enable CH1 output, positive pol
-	TIM1->CCER |= TIM_CC1E | TIM_CC1P;
-
-	// Enable CH2 output, positive pol
-	TIM1->CCER |= TIM_CC2E | TIM_CC2P;
+	// Pins and outputs of the channels in LED_MAP, and TIM2 if it has LEDs
+	leds_init();
 
-	// Enable CH3 output, positive pol
-	TIM1->CCER |= TIM_CC3E | TIM_CC3P;
+#ifdef DMA_PLAYBACK
+	// CH1-4 Mode is output, PWM1 (CC1S = 00, OC1M = 110)
+	TIM1->CHCTLR1 |= TIM_OC1M_2 | TIM_OC1M_1;
+	TIM1->CHCTLR1 |= TIM_OC2M_2 | TIM_OC2M_1;
+	TIM1->CHCTLR2 |= TIM_OC3M_2 | TIM_OC3M_1;
+	TIM1->CHCTLR2 |= TIM_OC4M_2 | TIM_OC4M_1;
 
-	// Enable CH4 output, positive pol
-	TIM1->CCER |= TIM_CC4E | TIM_CC4P;
+	// Set the Capture Compare Register value to 0% initially
+	TIM1->CH1CVR = 0;
+	TIM1->CH2CVR = 0;
+	TIM1->CH3CVR = 0;
+	TIM1->CH4CVR = 0;
 
+	// Enable TIM1 outputs. TIM1DMAPWMStart() starts the timer.
+	TIM1->BDTR |= TIM_MOE;
+	TIM1DMAPWMInit();
+#else
 	// CH1 Mode is output, PWM1 (CC1S = 00, OC1M = 011)
 	TIM1->CHCTLR1 |= TIM_OC1M_0 | TIM_OC1M_1;
 	TIM1->CHCTLR1 |= TIM_OC2M_0 | TIM_OC2M_1;
@@ -275,97 +316,346 @@ void aemhead_init( void )
 	// Enable TIM1 outputs
 	TIM1->BDTR |= TIM_MOE;
 
+	// Interrupt at the end of each pulse, to wake us up from sleep
+	TIM1->DMAINTENR |= TIM_UIE;
+	NVIC_EnableIRQ(TIM1_UP_IRQn);
+
 	// Enable TIM1
 	TIM1->CTLR1 |= TIM_CEN;
+#endif
 }
 
-typedef void (*style)(void);
-style styles[] = {&LEDBeats, &Breathe};
+// Play styles back from the tables baked by tools/pattern_compiler.c instead of
+// computing them every wake. Comment out to run the live versions in patterns.c
+#define BAKED_PATTERNS
+
+// Styles written in the pattern language (vm_styles.pat) end in _vm. Custom_vm
+// is whatever was last sent with make upload, Chase_vm until then.
+#ifdef BAKED_PATTERNS
+style styles[] = {&LEDBeats_baked, &Breathe_baked, &Candle, &Sparkle, &Custom_vm};
+#else
+style styles[] = {&LEDBeats, &Breathe, &Candle, &Sparkle, &Custom_vm};
+#endif
 uint8_t style_index = 0;
+uint8_t sleep_wakes = 1;
+uint8_t slept_wakes = 0;
+
+#define NUM_STYLES (sizeof(styles) / sizeof(styles[0]))
 
 void increment_style_index() {
-	style_index = (style_index + 1) % (sizeof(styles) / sizeof(styles[0]));
+	style_index = (style_index + 1) % NUM_STYLES;
 }
 
-void write_pwm_vals() {
-	for (i = 0; i < NUM_LEDS; i++) {
-		t1pwm_setpw(i, next_pwm_vals[i]);
+void decrement_style_index() {
+	style_index = (style_index + NUM_STYLES - 1) % NUM_STYLES;
+}
+
+// Takes effect from the next pulse, TIM1 loads PSC at the end of each one
+void set_brightness(uint8_t index) {
+	brightness_index = index;
+	leds_set_prescaler(brightness_prescalers[index]);
+#ifdef DMA_PLAYBACK
+	// Keep the frame the same length
+	TIM1->ATRLR = DMA_FRAME_CYCLES / (brightness_prescalers[index] + 1) - 1;
+#endif
+}
+
+const uint16_t setting_defaults[NUM_SETTINGS] = {
+	0, // SETTING_STYLE
+	DEFAULT_BRIGHTNESS, // SETTING_BRIGHTNESS
+};
+
+void load_settings() {
+	settings_init(setting_defaults);
+	style_index = settings_get(SETTING_STYLE);
+	if (style_index >= NUM_STYLES) {
+		style_index = 0;
 	}
+	brightness_index = settings_get(SETTING_BRIGHTNESS);
+	if (brightness_index >= NUM_BRIGHTNESS) {
+		brightness_index = DEFAULT_BRIGHTNESS;
+	}
+	set_brightness(brightness_index);
+}
+
+void save_settings() {
+	settings_set(SETTING_STYLE, style_index);
+	settings_set(SETTING_BRIGHTNESS, brightness_index);
+}
+
+// PWM counts for this pulse, after dithering
+uint16_t pwm_vals[NUM_LEDS];
+
+void write_pwm_vals() {
+	dither_pwm_vals(pwm_vals);
+	leds_write(pwm_vals);
 }
 
 // Intent is to have millis() == 0 after this function runs
 void reset_millis_offset() {
 	millis_start = SysTick->CNT / DELAY_MS_TIME;
 	deep_sleep_time_ms = 0;
+	reset_patterns();
+	vm_reset();
+}
+
+uint8_t button_down() {
+	return GPIO_digitalRead(GPIOv_from_PORT_PIN(GPIO_port_D, 0)) == high;
+}
+
+// Whether something other than the AWU ended the sleep: a button edge or,
+// with BADGE_SYNC, a beacon. Either one is still on its pin when we wake.
+uint8_t woke_early() {
+	if (button_down() != button_is_pressed) {
+		return 1;
+	}
+#ifdef BADGE_SYNC
+	if (sync_beacon_coming()) {
+		return 1;
+	}
+#endif
+	return 0;
 }
 
-void update_button_state() {
-	// Check style button state
-	// If user pressed the button, they must release it before pressing again
-	// (time held doesn't matter)
-	if (button_is_pressed == 0 &&
-			GPIO_digitalRead(GPIOv_from_PORT_PIN(GPIO_port_D, 0)) == high &&
-			millis() > (button_released_press_ms + BUTTON_DEBOUNCE_DELAY_MS))
-	{
-		button_is_pressed = 1;
-		increment_style_index();
-		// Start patterns at the beginning
+// Debounce state machine, run once per wake, or with DMA_PLAYBACK once per
+// half buffer of frames. wakes is how many have passed since the last call.
+// The first edge counts straight away, then the button is ignored (and can't
+// wake us) for BUTTON_DEBOUNCE_WAKES wakes while it bounces. Those wakes come
+// from the AWU, so they are exactly DEEP_SLEEP_TIME_MS apart.
+void update_button_state(uint8_t wakes) {
+	uint8_t down = button_down();
+	uint8_t held = button_held_wakes;
+
+	if (button_debounce_wakes) {
+		button_debounce_wakes = (button_debounce_wakes > wakes) ? button_debounce_wakes - wakes : 0;
+		if (button_debounce_wakes == 0) {
+			EXTI->EVENR |= EXTI_Line0;
+		}
+	} else if (down != button_is_pressed) {
+		button_is_pressed = down;
+		button_debounce_wakes = BUTTON_DEBOUNCE_WAKES;
+		EXTI->EVENR &= ~EXTI_Line0;
+		if (down) {
+			// If user pressed the button, they must release it before pressing
+			// again
+			held = button_held_wakes = 0;
+			increment_style_index();
+			// Start patterns at the beginning
+			reset_millis_offset();
+		} else {
+			// Only write flash once the user is done
+			save_settings();
+		}
+	}
+
+	if (button_is_pressed) {
+		button_held_wakes = (held > 255 - wakes) ? 255 : held + wakes;
+		if (held < LONG_PRESS_WAKES && button_held_wakes >= LONG_PRESS_WAKES) {
+			// It's a long press, so put the style back
+			decrement_style_index();
+			reset_millis_offset();
+			brightness_step_wakes = 0;
+		}
+		if (button_held_wakes >= LONG_PRESS_WAKES) {
+			if (brightness_step_wakes < wakes) {
+				set_brightness((brightness_index + 1) % NUM_BRIGHTNESS);
+				brightness_step_wakes += BRIGHTNESS_STEP_WAKES;
+			}
+			brightness_step_wakes -= wakes;
+		}
+	}
+}
+
+#ifdef DMA_PLAYBACK
+uint8_t dma_dark_frames = 0;
+uint8_t dma_frame_count = 0;
+
+// Called from the DMA interrupt for every frame it queues up. Does what the
+// main loop does every wake, minus the pulse.
+void TIM1DMAPWMFrameCallback( uint16_t * cvr )
+{
+	// A half buffer of frames is worked out back to back in one interrupt, so
+	// the button is only looked at on the first of them, for all of them.
+	// Otherwise the debounce would be over before the contacts stopped.
+	if (dma_frame_count++ % (TIM1DMAPWM_FRAMES / 2) == 0) {
+		update_button_state(TIM1DMAPWM_FRAMES / 2);
+	}
+	if (dma_dark_frames) {
+		// The style asked to skip these, all LEDs are off
+		dma_dark_frames--;
+		cvr[0] = cvr[1] = cvr[2] = cvr[3] = 0;
+		return;
+	}
+	max_sleep_wakes = (button_is_pressed || button_debounce_wakes) ? 1 : MAX_SLEEP_WAKES;
+	dma_dark_frames = styles[style_index]() - 1;
+	dither_pwm_vals(pwm_vals);
+	leds_dma_frame(cvr, pwm_vals);
+}
+#endif
+
+#ifdef BADGE_SYNC
+// Set when a beacon ended a sleep of more than one wake early
+uint8_t sync_realign_due = 0;
+
+// Run the style through wakes it wasn't called for, millis() styles included
+void sync_replay(uint16_t wakes) {
+	max_sleep_wakes = 1;
+	while (wakes--) {
+		styles[style_index]();
+		add_sleep_time(1);
+	}
+}
+
+// Bring the patterns in line with the other badges after sync_wake()
+void sync_catch_up(uint8_t wakes) {
+	if (sync_wakes == 0) {
+		// New epoch, every badge starts over together
 		reset_millis_offset();
-		button_started_press_ms = millis();
+		return;
 	}
-	if (button_is_pressed == 1 &&
-			GPIO_digitalRead(GPIOv_from_PORT_PIN(GPIO_port_D, 0)) == low &&
-			millis() > (button_started_press_ms + BUTTON_DEBOUNCE_DELAY_MS))
-	{
-		button_is_pressed = 0;
-		button_released_press_ms = millis();
+	sync_replay(wakes);
+}
+
+// After a beacon woke us partway through a long sleep the style has already
+// gone through all of it, so it would stay ahead of sync_wakes until the next
+// epoch. Start it over and run it up to sync_wakes instead. Beacons only end
+// long sleeps while listening for a whole period, at the start of an epoch or
+// after power on, so that is a few hundred wakes at most.
+void sync_realign() {
+	sync_realign_due = 0;
+	reset_millis_offset();
+	sync_replay(sync_wakes);
+}
+#endif
+
+// Holding the button at power on stays awake, so the debug link works, and
+// takes styles from minichlink -S (make upload) until the button is pressed
+// again. The LEDs stay dark meanwhile.
+void upload_mode() {
+	while (button_down());
+	Delay_Ms(BUTTON_DEBOUNCE_WAKES * DEEP_SLEEP_TIME_MS);
+	while (!button_down()) {
+		upload_poll();
 	}
+	Delay_Ms(BUTTON_DEBOUNCE_WAKES * DEEP_SLEEP_TIME_MS);
+	while (button_down());
+}
+
+// Seed the random styles from the bottom bits of the internal reference,
+// sampled as briefly as the ADC allows so the noise isn't averaged away. The
+// ADC is only powered for this.
+void seed_random() {
+	uint32_t seed = 0;
+	uint8_t n;
+
+	GPIO_ADCinit();
+	GPIO_ADC_set_sampletime(GPIO_AinVref, GPIO_ADC_sampletime_3cy);
+	for (n = 0; n < 32; n++) {
+		seed = (seed << 3 | seed >> 29) ^ GPIO_analogRead(GPIO_AinVref);
+	}
+	GPIO_ADC_set_power(0);
+	RCC->APB2PCENR &= ~RCC_APB2Periph_ADC1;
+	rng_seed(seed);
 }
 
 int main()
 {
-	// For now, run ../ch32v003fun/minichlink/minichlink -u to unbrick and wipe the flash
-	// so you can repogramH
-	// TODO: Would like to move to just holding down the style button to enter bootloader mode
-	//       when powering on but didn't get there in time
-
 	SystemInit();
 
 	// init TIM1 for PWM
 	aemhead_init();
 
+	seed_random();
+
+	// Pick up where we were before the battery came out
+	load_settings();
+	upload_init();
+	// The debug link can't reach the badge in standby. Powering on with the
+	// button held keeps it awake to reflash, or minichlink -u wipes the flash.
+	if (button_down()) {
+		upload_mode();
+	}
+
 	//RCC->CFGR0 = BASE_CFGR0_NEW;
 
 
   reset_millis_offset();
 #ifdef DEEP_SLEEP
 	setup_deep_sleep();
+	calibrate_wakes();
+#endif
+#ifdef BADGE_SYNC
+	sync_init();
 #endif
+#ifdef DMA_PLAYBACK
+	// Everything happens in TIM1DMAPWMFrameCallback() from here on
+	TIM1DMAPWMStart();
 	while(1) {
-		update_button_state();
+		__WFI();
+	}
+#endif
+	while(1) {
+#ifdef BADGE_SYNC
+		sync_catch_up(sync_wake());
+#endif
+		update_button_state(1);
 
 		// Write pwm values into timer registers
 		write_pwm_vals();
 
-		// Enable timer1 (one-shot)
-		TIM1->CTLR1 |= TIM_CEN;
+		// Enable the timers (one-shot)
+		leds_start();
 
 		// Determine next values of LEDs for next awake period while
-		// timer is running
-		styles[style_index]();
+		// timer is running. Keep waking every time while the button is held
+		// or settling, so the debounce and hold timing stay in whole wakes.
+		max_sleep_wakes = (button_is_pressed || button_debounce_wakes) ? 1 : MAX_SLEEP_WAKES;
+#ifdef BADGE_SYNC
+		max_sleep_wakes = sync_sleep_wakes(max_sleep_wakes);
+#endif
+		sleep_wakes = styles[style_index]();
 
 		// Wait until TIM1 is done with pulse
-		while (TIM1->CTLR1 & TIM_CEN);
+		wait_for_pulse();
 
 #ifdef DEEP_SLEEP
-		// Go to sleep
-		__WFE();
-		// Restore clocks, etc
-		SystemInit();
-		//
-		deep_sleep_time_ms += DEEP_SLEEP_TIME_MS;
+		// Go to sleep, for longer if the LEDs are dark for a while. When a
+		// calibration is due, a long enough dark stretch starts with it.
+		slept_wakes = 0;
+		if (!calibrate_wakes_left && sleep_wakes > CALIBRATE_WAKES) {
+			calibrate_wakes();
+			calibrate_wakes_left = CALIBRATE_EVERY_WAKES;
+			slept_wakes = CALIBRATE_WAKES + 1;
+		}
+		if (slept_wakes < sleep_wakes) {
+			set_sleep_wakes(sleep_wakes - slept_wakes);
+			__WFE();
+			// Restore clocks. Standby keeps everything else, so no need for SystemInit()
+#ifdef RESUME_ON_HSI
+			SystemResumeFromStandby( 0 );
 #else
-		Delay_Ms( DEEP_SLEEP_TIME_MS );
+			SystemResumeFromStandby( 1 );
+#endif
+			// Woken early, there's no telling how many wakes passed, so count
+			// one. Counting the whole sleep would run millis() and the sync
+			// count ahead of where they really are.
+			if (woke_early()) {
+#ifdef BADGE_SYNC
+				sync_realign_due = sync_beacon_coming() && sleep_wakes > slept_wakes + 1;
+#endif
+				sleep_wakes = slept_wakes + 1;
+			}
+		}
+		add_sleep_time(sleep_wakes);
+		calibrate_wakes_left = (calibrate_wakes_left > sleep_wakes) ? calibrate_wakes_left - sleep_wakes : 0;
+#ifdef BADGE_SYNC
+		sync_slept(sleep_wakes);
+		if (sync_realign_due) {
+			sync_realign();
+		}
+#endif
+#else
+		Delay_Ms( sleep_wakes * DEEP_SLEEP_TIME_MS );
 #endif
 	}
 }
@@ -376,8 +666,3 @@ int main()
 
 //  Patterns:
 //   * Sawtooth like Alton
-//   * Something random but not taxing
-
-// Nice to have
-//  * Adjust brightness by holding down button. Adjusts prescalar from a few set values in a circular array. Set PWM brightness to max during this time?
-//  * Save settings...https://github.com/cnlohr/ch32v003fun/pull/85 and https://github.com/recallmenot/ch32v003fun_wildwest/blob/main/lib%2Fch32v003_flash.h
\ No newline at end of file
@@ -0,0 +1,123 @@
+// Benchmark for the badge styles. Built just like the real firmware, but run
+// under tools/rv32ec_sim instead of on a badge. From the top level: make bench
+//
+// Each style is run for BENCH_WAKES wakes worth of time, the same way the main
+// loop in tim1_pwm.c does, and every call is counted. Styles that sleep through
+// dark stretches get called fewer times. The "write_pwm_vals" region is the
+// cost of getting a pulse's values out to the timers, whatever LED_MAP is.
+//
+// Then each style is run again the way DMA_PLAYBACK in tim1_pwm.c runs it, from
+// the half-buffer refill in extralibs/tim1_dma_pwm.h. Those regions are named
+// "<style>@dma" and cover TIM1DMAPWM_FRAMES/2 frames each. The interrupt entry
+// and exit are not counted. The styles come from
+// tools/style_list.h.
+
+#include "ch32v003fun.h"
+#include "patterns.h"
+#include "vm.h"
+#include "random_styles.h"
+#include "leds.h"
+#include "sim.h"
+
+#define TIM1DMAPWM_IMPLEMENTATION
+#include "tim1_dma_pwm.h"
+
+// About 20 seconds of wakes: a dozen or so beats and two breaths
+#define BENCH_WAKES 1200
+
+long millis_start = 0;
+long deep_sleep_time_ms = 0;
+
+struct bench
+{
+	const char * name;
+	style fn;
+};
+
+const struct bench benches[] = {
+#define STYLE( fn ) { #fn, fn },
+#include "style_list.h"
+#undef STYLE
+};
+
+const struct bench dma_benches[] = {
+#define STYLE( fn ) { #fn "@dma", fn },
+#include "style_list.h"
+#undef STYLE
+};
+
+style dma_style;
+uint8_t dma_dark_frames;
+uint16_t pwm_vals[NUM_LEDS];
+
+// Same as the one in tim1_pwm.c, minus the button
+void TIM1DMAPWMFrameCallback( uint16_t * cvr )
+{
+	if( dma_dark_frames )
+	{
+		dma_dark_frames--;
+		cvr[0] = cvr[1] = cvr[2] = cvr[3] = 0;
+		return;
+	}
+	dma_dark_frames = dma_style() - 1;
+	dither_pwm_vals( pwm_vals );
+	leds_dma_frame( cvr, pwm_vals );
+}
+
+int main()
+{
+	int b, w;
+	uint8_t wakes;
+
+	sim_begin( "SystemInit" );
+	SystemInit();
+	sim_end();
+
+	// What the main loop actually runs after every wake
+	sim_begin( "SystemResumeFromStandby" );
+	SystemResumeFromStandby( 1 );
+	sim_end();
+
+	// And what it does to get the values out for each pulse
+	leds_init();
+	sim_begin( "write_pwm_vals" );
+	dither_pwm_vals( pwm_vals );
+	leds_write( pwm_vals );
+	sim_end();
+
+	for( b = 0; b < sizeof( benches ) / sizeof( benches[0] ); b++ )
+	{
+		millis_start = SysTick->CNT / DELAY_MS_TIME;
+		deep_sleep_time_ms = 0;
+		reset_patterns();
+		vm_reset();
+
+		for( w = 0; w < BENCH_WAKES; w += wakes )
+		{
+			sim_begin( benches[b].name );
+			wakes = benches[b].fn();
+			sim_end();
+			deep_sleep_time_ms += wakes * DEEP_SLEEP_TIME_MS;
+		}
+	}
+
+	for( b = 0; b < sizeof( dma_benches ) / sizeof( dma_benches[0] ); b++ )
+	{
+		millis_start = SysTick->CNT / DELAY_MS_TIME;
+		deep_sleep_time_ms = 0;
+		reset_patterns();
+		vm_reset();
+		dma_style = dma_benches[b].fn;
+		dma_dark_frames = 0;
+
+		for( w = 0; w < BENCH_WAKES; w += TIM1DMAPWM_FRAMES / 2 )
+		{
+			sim_begin( dma_benches[b].name );
+			TIM1DMAPWMFillFrames( TIM1DMAPWMbuff, TIM1DMAPWM_FRAMES / 2 );
+			sim_end();
+		}
+	}
+
+	sim_exit( 0 );
+	while( 1 );
+}
@@ -0,0 +1,26 @@
+#ifndef _SIM_H
+#define _SIM_H
+
+// Calls from a program running under tools/rv32ec_sim to the simulator.
+// The command goes in a0 and its argument in a1, then ecall.
+
+#define SIM_EXIT  0 // a1 = exit code
+#define SIM_BEGIN 1 // a1 = pointer to region name. Start counting.
+#define SIM_END   2 // Stop counting, add to the region's totals.
+
+#ifdef __riscv
+
+static inline void sim_call( int cmd, const void * arg )
+{
+	register int a0 asm( "a0" ) = cmd;
+	register const void * a1 asm( "a1" ) = arg;
+	asm volatile( "ecall" : : "r"( a0 ), "r"( a1 ) : "memory" );
+}
+
+#define sim_begin( name ) sim_call( SIM_BEGIN, name )
+#define sim_end() sim_call( SIM_END, 0 )
+#define sim_exit( code ) sim_call( SIM_EXIT, (const void *)(code) )
+
+#endif
+
+#endif
@@ -0,0 +1,142 @@
+// CIE 1931 lightness table generator.
+//
+// Perceived brightness (CIE L*) is far from linear in LED duty cycle, so a
+// fade that steps evenly through the table looks even to the eye. This emits
+// one const table per spec, so the size of each table can be picked to fit
+// the flash/smoothness trade-off instead of pasting a table in by hand.
+//
+// A spec is name:entries:bits[:dither]. The table has entries values, going
+// from 0 to ((1 << bits) - 1) << dither, so bits is the PWM resolution and
+// dither is the number of extra bits for dither_pwm_vals(). Tables whose top
+// value fits in a byte are uint8_t, the rest uint16_t.
+//
+// With -H the header (declarations, plus <name>_LEN and <name>_MAX) is
+// written instead of the tables.
+//
+// Usage: cie_gen [-H] spec... > cie_tables.c
+//   e.g. cie_gen CIE:256:10:4                  (the Makefile default)
+//        cie_gen CIE:256:10:4 CIE64:64:8        (plus a small 8-bit table)
+//        cie_gen CIE:256:10:4 CIE1024:1024:10:4 (plus a finer dithered one)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define MAX_SPECS 16
+#define MAX_NAME 32
+
+struct cie_spec
+{
+	char name[MAX_NAME];
+	int entries;
+	int bits;
+	int dither;
+};
+
+static struct cie_spec specs[MAX_SPECS];
+static int num_specs;
+
+static long spec_max( const struct cie_spec * s )
+{
+	return ( ( 1L << s->bits ) - 1 ) << s->dither;
+}
+
+static const char * spec_type( const struct cie_spec * s )
+{
+	return ( spec_max( s ) <= 0xff ) ? "uint8_t" : "uint16_t";
+}
+
+// Relative luminance Y (0 to 1) for lightness L* (0 to 100)
+static double cie_y( double l )
+{
+	if( l <= 8 )
+		return l / 903.3;
+	return pow( ( l + 16 ) / 116, 3 );
+}
+
+static int parse_spec( const char * arg, struct cie_spec * s )
+{
+	const char * colon = strchr( arg, ':' );
+	int n;
+	if( !colon || colon == arg || colon - arg >= MAX_NAME ) return -1;
+	memcpy( s->name, arg, colon - arg );
+	s->name[colon - arg] = 0;
+	s->dither = 0;
+	n = sscanf( colon + 1, "%d:%d:%d", &s->entries, &s->bits, &s->dither );
+	if( n < 2 ) return -1;
+	if( s->entries < 2 || s->bits < 1 || s->dither < 0 || s->bits + s->dither > 16 ) return -1;
+	return 0;
+}
+
+static void print_header( )
+{
+	int k;
+	printf( "// Generated by tools/cie_gen.c -- do not edit.\n" );
+	printf( "// Regenerate with: make cie_tables.h\n\n" );
+	printf( "#ifndef _CIE_TABLES_H\n#define _CIE_TABLES_H\n\n#include <stdint.h>\n" );
+	for( k = 0; k < num_specs; k++ )
+	{
+		const struct cie_spec * s = &specs[k];
+		printf( "\n// %d entries, 0 to %ld (%d bits", s->entries, spec_max( s ), s->bits );
+		if( s->dither ) printf( " + %d dither bits", s->dither );
+		printf( ")\n" );
+		printf( "#define %s_LEN %d\n", s->name, s->entries );
+		printf( "#define %s_MAX %ld\n", s->name, spec_max( s ) );
+		printf( "extern const %s %s[%s_LEN];\n", spec_type( s ), s->name, s->name );
+	}
+	printf( "\n#endif\n" );
+}
+
+static void print_tables( )
+{
+	int k, i;
+	printf( "// Generated by tools/cie_gen.c -- do not edit.\n" );
+	printf( "// Regenerate with: make cie_tables.c\n\n" );
+	printf( "#include \"cie_tables.h\"\n" );
+	for( k = 0; k < num_specs; k++ )
+	{
+		const struct cie_spec * s = &specs[k];
+		long max = spec_max( s );
+		int width = ( max <= 0xff ) ? 3 : 5;
+		printf( "\nconst %s %s[%s_LEN] = {", spec_type( s ), s->name, s->name );
+		for( i = 0; i < s->entries; i++ )
+		{
+			double l = 100.0 * i / ( s->entries - 1 );
+			long v = lround( cie_y( l ) * max );
+			printf( "%s%*ld,", ( i % 16 ) ? " " : "\n\t", width, v );
+		}
+		printf( "\n};\n" );
+	}
+}
+
+int main( int argc, char ** argv )
+{
+	int header = 0;
+	int a;
+	for( a = 1; a < argc; a++ )
+	{
+		if( strcmp( argv[a], "-H" ) == 0 )
+		{
+			header = 1;
+			continue;
+		}
+		if( num_specs == MAX_SPECS || parse_spec( argv[a], &specs[num_specs] ) )
+		{
+			fprintf( stderr, "Bad table spec \"%s\", want name:entries:bits[:dither]\n", argv[a] );
+			return 1;
+		}
+		num_specs++;
+	}
+	if( !num_specs )
+	{
+		fprintf( stderr, "Usage: cie_gen [-H] name:entries:bits[:dither]...\n" );
+		return 1;
+	}
+
+	if( header )
+		print_header( );
+	else
+		print_tables( );
+	return 0;
+}
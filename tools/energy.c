@@ -0,0 +1,322 @@
+// Energy budget estimator.
+//
+// Turns the per-wake cycle counts from the simulator (rv32ec_sim -c) into an
+// average current and battery life for each style. Each wake costs:
+//
+//   * waking from standby, and getting the clocks back (the
+//     "SystemResumeFromStandby" region of the bench if there is one, otherwise
+//     "SystemInit", plus the PLL lock time)
+//   * the style itself, which runs while TIM1 sends its one pulse, then the
+//     rest of the pulse (if any) in sleep mode with the clocks still running
+//   * the fixed main loop overhead (button, write_pwm_vals)
+//   * the LEDs, on for next_pwm_vals/MAX_FINE_PWM_VAL of the pulse
+//
+// followed by DEEP_SLEEP_TIME_MS of standby, or a multiple of it when the style
+// sleeps through a dark stretch. LED brightness and how often the style really
+// wakes come from running the styles on the host, like tools/pattern_compiler
+// does.
+//
+// Regions named "<style>@dma" in the bench are the same style played back with
+// DMA (DMA_PLAYBACK in tim1_pwm.c). There is no standby there: the core sleeps
+// with the clocks running between refills, and only wakes for the refills. Those
+// get a second table, for comparison.
+//
+// With -s the results are saved as a baseline. With -B the results are
+// compared against a saved baseline, and the exit code is nonzero if any
+// style's average current went up by more than the threshold (-t), or a style
+// in the baseline is missing from the bench. New styles are listed, but pass.
+//
+// The current figures default to rough CH32V003 datasheet numbers at 3.3 V.
+// Measure your own board and pass them in for real numbers.
+//
+// Usage: energy [options] bench.csv
+//   -f hz       HCLK (default 3000000, 48 MHz PLL / 16)
+//   -r mA       Run current at that HCLK (default 1.5)
+//   -z uA       Standby current with LSI and AWU running (default 9)
+//   -p mA       Sleep mode current, clocks running (default 0.9)
+//   -u us       Wake up from standby plus PLL lock (default 250)
+//   -o cycles   Main loop overhead per wake (default 400)
+//   -l mA       Current per LED when fully on (default 5)
+//   -b mAh      Battery capacity (default 220, a CR2032)
+//   -s file     Save results as a baseline
+//   -B file     Compare against a baseline
+//   -t percent  Allowed increase in average current (default 5)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../patterns.c"
+#include "../cie_tables.c"
+#include "../pattern_tables.c"
+#include "../vm.c"
+#include "../vm_programs.c"
+#include "../random_styles.c"
+#include "../ch32v003fun/extralibs/tim1_dma_pwm.h"
+
+#define STATS_WAKES 6000 // A bit under two minutes of wakes
+#define MAX_STYLES 32
+
+SysTick_Type mock_systick;
+long millis_start = 0;
+long deep_sleep_time_ms = 0;
+
+struct named_style
+{
+	const char * name;
+	style fn;
+};
+
+static const struct named_style all_styles[] = {
+#define STYLE( fn ) { #fn, fn },
+#include "style_list.h"
+#undef STYLE
+};
+#define NUM_ALL_STYLES (sizeof(all_styles)/sizeof(all_styles[0]))
+
+struct result
+{
+	char name[32];
+	double cycles;
+	double awake_ms;
+	double led_duty;
+	double wake_ratio;
+	double avg_ma;
+	double life_h;
+	double dma_cycles; // Per frame, 0 if not benched
+};
+
+static struct result results[MAX_STYLES];
+static int num_results;
+
+// Average fraction of the pulse each LED is on, summed over the LEDs, and the
+// fraction of DEEP_SLEEP_TIME_MS slots the badge is actually awake for.
+static double led_duty( const char * name, double * wake_ratio )
+{
+	int s, w, led;
+	int calls = 0;
+	uint8_t wakes;
+	double total = 0;
+	*wake_ratio = 1;
+	for( s = 0; s < NUM_ALL_STYLES; s++ )
+	{
+		if( strcmp( all_styles[s].name, name ) ) continue;
+		reset_patterns();
+		vm_reset();
+		for( w = 0; w < STATS_WAKES; w += wakes )
+		{
+			mock_systick.CNT = 0;
+			deep_sleep_time_ms = (long)w * DEEP_SLEEP_TIME_MS;
+			wakes = all_styles[s].fn();
+			calls++;
+			// The wakes that were skipped are dark
+			for( led = 0; led < NUM_LEDS; led++ )
+				total += next_pwm_vals[led];
+		}
+		*wake_ratio = (double)calls / w;
+		return total / w / MAX_FINE_PWM_VAL;
+	}
+	fprintf( stderr, "Warning: %s is not in style_list.h, assuming the LEDs are off\n", name );
+	return 0;
+}
+
+static int read_csv( const char * file, char names[][32], double * values, int max )
+{
+	char line[256];
+	int n = 0;
+	FILE * f = fopen( file, "r" );
+	if( !f )
+	{
+		fprintf( stderr, "Error: Could not open %s\n", file );
+		exit( -1 );
+	}
+	while( fgets( line, sizeof( line ), f ) && n < max )
+	{
+		char * comma = strchr( line, ',' );
+		if( !comma || strncmp( line, "style,", 6 ) == 0 ) continue;
+		*comma = 0;
+		snprintf( names[n], 32, "%.31s", line );
+		values[n] = atof( comma + 1 );
+		n++;
+	}
+	fclose( f );
+	return n;
+}
+
+int main( int argc, char ** argv )
+{
+	double hclk = 3000000, run_ma = 1.5, standby_ua = 9, sleep_ma = 0.9, wake_us = 250, overhead = 400;
+	double led_ma = 5, battery_mah = 220, threshold = 5;
+	const char * save = 0, * baseline = 0, * bench = 0;
+	char line[256];
+	double init_cycles = 0;
+	double pulse_cycles = (double)( PWM_PRESCALER + 1 ) * MAX_PWM_VAL;
+	int regressions = 0;
+	int have_resume = 0;
+	int have_dma = 0;
+	int i;
+	FILE * f;
+
+	for( i = 1; i < argc; i++ )
+	{
+		const char * a = argv[i];
+		if( a[0] == '-' && i + 1 < argc )
+		{
+			const char * v = argv[++i];
+			switch( a[1] )
+			{
+			case 'f': hclk = atof( v ); break;
+			case 'r': run_ma = atof( v ); break;
+			case 'z': standby_ua = atof( v ); break;
+			case 'p': sleep_ma = atof( v ); break;
+			case 'u': wake_us = atof( v ); break;
+			case 'o': overhead = atof( v ); break;
+			case 'l': led_ma = atof( v ); break;
+			case 'b': battery_mah = atof( v ); break;
+			case 's': save = v; break;
+			case 'B': baseline = v; break;
+			case 't': threshold = atof( v ); break;
+			default: bench = 0; i = argc; break;
+			}
+		}
+		else
+			bench = a;
+	}
+	if( !bench )
+	{
+		fprintf( stderr, "Usage: %s [-f hz] [-r mA] [-z uA] [-p mA] [-u us] [-o cycles] [-l mA] [-b mAh] [-s file] [-B file] [-t percent] bench.csv\n", argv[0] );
+		return -1;
+	}
+
+	f = fopen( bench, "r" );
+	if( !f )
+	{
+		fprintf( stderr, "Error: Could not open %s\n", bench );
+		return -1;
+	}
+	// region,runs,instructions,cycles,max_cycles
+	while( fgets( line, sizeof( line ), f ) )
+	{
+		char name[32];
+		unsigned long runs;
+		double instr, cycles;
+		if( sscanf( line, "%31[^,],%lu,%lf,%lf", name, &runs, &instr, &cycles ) != 4 ) continue;
+		if( strcmp( name, "SystemResumeFromStandby" ) == 0 )
+		{
+			init_cycles = cycles;
+			have_resume = 1;
+			continue;
+		}
+		if( strcmp( name, "SystemInit" ) == 0 )
+		{
+			if( !have_resume ) init_cycles = cycles;
+			continue;
+		}
+		// Part of the main loop overhead (-o)
+		if( strcmp( name, "write_pwm_vals" ) == 0 ) continue;
+		if( strstr( name, "@dma" ) )
+		{
+			*strstr( name, "@dma" ) = 0;
+			for( i = 0; i < num_results; i++ )
+			{
+				if( strcmp( results[i].name, name ) ) continue;
+				results[i].dma_cycles = cycles / ( TIM1DMAPWM_FRAMES / 2 );
+				have_dma = 1;
+			}
+			continue;
+		}
+		if( num_results == MAX_STYLES ) break;
+		snprintf( results[num_results].name, sizeof( results[num_results].name ), "%s", name );
+		results[num_results].cycles = cycles;
+		num_results++;
+	}
+	fclose( f );
+
+	printf( "HCLK %.0f Hz, pulse %.0f cycles, standby %d ms, %s %.0f cycles\n\n", hclk, pulse_cycles, DEEP_SLEEP_TIME_MS, have_resume ? "resume" : "SystemInit", init_cycles );
+	printf( "%-20s %10s %10s %10s %10s %10s %10s\n", "style", "cycles", "wakes", "awake ms", "LED duty", "avg mA", "life h" );
+	for( i = 0; i < num_results; i++ )
+	{
+		struct result * r = &results[i];
+		double wait = ( r->cycles < pulse_cycles ) ? pulse_cycles - r->cycles : 0;
+		double run_s = ( init_cycles + r->cycles + overhead ) / hclk + wake_us / 1e6;
+		double wait_s = wait / hclk;
+		double awake_s;
+		double sleep_s = DEEP_SLEEP_TIME_MS / 1000.0;
+		double mas;
+		r->led_duty = led_duty( r->name, &r->wake_ratio );
+		// Per DEEP_SLEEP_TIME_MS slot. Only some slots have a wake in them.
+		run_s *= r->wake_ratio;
+		wait_s *= r->wake_ratio;
+		awake_s = run_s + wait_s;
+		mas = run_ma * run_s + sleep_ma * wait_s + standby_ua / 1000.0 * sleep_s + r->led_duty * ( pulse_cycles / hclk ) * led_ma;
+		r->awake_ms = awake_s * 1000;
+		r->avg_ma = mas / ( awake_s + sleep_s );
+		r->life_h = battery_mah / r->avg_ma;
+		printf( "%-20s %10.0f %9.1f%% %10.3f %10.3f %10.4f %10.1f\n", r->name, r->cycles, r->wake_ratio * 100, r->awake_ms, r->led_duty, r->avg_ma, r->life_h );
+	}
+
+	if( have_dma )
+	{
+		printf( "\nDMA playback, %d frame buffer, %.1f mA sleep:\n", TIM1DMAPWM_FRAMES, sleep_ma );
+		printf( "%-20s %10s %10s %10s %10s\n", "style", "cyc/frame", "awake ms", "avg mA", "life h" );
+		for( i = 0; i < num_results; i++ )
+		{
+			struct result * r = &results[i];
+			double slot_s = DEEP_SLEEP_TIME_MS / 1000.0;
+			double awake_s = r->dma_cycles / hclk;
+			double mas, avg_ma;
+			if( !r->dma_cycles ) continue;
+			mas = run_ma * awake_s + sleep_ma * ( slot_s - awake_s ) + r->led_duty * ( pulse_cycles / hclk ) * led_ma;
+			avg_ma = mas / slot_s;
+			printf( "%-20s %10.0f %10.3f %10.4f %10.1f\n", r->name, r->dma_cycles, awake_s * 1000, avg_ma, battery_mah / avg_ma );
+		}
+	}
+
+	if( baseline )
+	{
+		char names[MAX_STYLES][32];
+		double values[MAX_STYLES];
+		int n = read_csv( baseline, names, values, MAX_STYLES );
+		int j;
+		printf( "\nCompared to %s (threshold %.1f%%):\n", baseline, threshold );
+		for( i = 0; i < num_results; i++ )
+		{
+			for( j = 0; j < n; j++ )
+			{
+				double change;
+				if( strcmp( names[j], results[i].name ) ) continue;
+				change = ( results[i].avg_ma - values[j] ) * 100.0 / values[j];
+				printf( "%-20s %+8.2f%%%s\n", results[i].name, change, ( change > threshold ) ? "  <-- REGRESSION" : "" );
+				if( change > threshold ) regressions++;
+				break;
+			}
+			if( j == n )
+				printf( "%-20s %9s\n", results[i].name, "new" );
+		}
+		// A style that dropped out of the bench can't be checked, so it fails
+		for( j = 0; j < n; j++ )
+		{
+			for( i = 0; i < num_results; i++ )
+				if( strcmp( names[j], results[i].name ) == 0 ) break;
+			if( i < num_results ) continue;
+			printf( "%-20s %9s  <-- MISSING\n", names[j], "missing" );
+			regressions++;
+		}
+	}
+
+	if( save )
+	{
+		f = fopen( save, "w" );
+		if( !f )
+		{
+			fprintf( stderr, "Error: Could not write %s\n", save );
+			return -1;
+		}
+		fprintf( f, "style,avg_ma\n" );
+		for( i = 0; i < num_results; i++ )
+			fprintf( f, "%s,%.6f\n", results[i].name, results[i].avg_ma );
+		fclose( f );
+	}
+
+	return regressions ? 1 : 0;
+}
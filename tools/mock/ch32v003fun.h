@@ -0,0 +1,26 @@
+// Host-side stand-in for ch32v003fun.h, so patterns.c can be compiled into the
+// tools in this directory. Only the registers the patterns touch are modelled,
+// and they are plain RAM the tool pokes directly.
+
+#ifndef __CH32V00x_H
+#define __CH32V00x_H
+
+#include <stdint.h>
+
+#define FUNCONF_SYSTEM_CORE_CLOCK 48000000
+#define DELAY_MS_TIME ((FUNCONF_SYSTEM_CORE_CLOCK)/8000)
+
+typedef struct
+{
+	volatile uint32_t CTLR;
+	volatile uint32_t SR;
+	volatile uint32_t CNT;
+	uint32_t RESERVED0;
+	volatile uint32_t CMP;
+	uint32_t RESERVED1;
+} SysTick_Type;
+
+extern SysTick_Type mock_systick;
+#define SysTick (&mock_systick)
+
+#endif
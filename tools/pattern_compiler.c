@@ -0,0 +1,164 @@
+// Offline pattern compiler.
+//
+// Runs the live styles from patterns.c on the host, once per simulated wake
+// (just like the main loop does), and bakes the resulting next_pwm_vals[]
+// into per-LED tables in flash. The badge then plays a style back with one
+// table load per LED (see play_baked()) instead of doing 32-bit divides on a
+// core with no hardware divider.
+//
+// Each LED gets its own loop length. A table covers the smallest whole number
+// of that LED's periods that lands (within LOOP_TOLERANCE_PPM) on a whole
+// number of wakes, so LEDs with slightly different periods keep drifting
+// against each other just like the live version.
+//
+// Usage: pattern_compiler > pattern_tables.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "../patterns.c"
+#include "../cie_tables.c"
+
+// How far a table loop may be off from a whole number of periods
+#define LOOP_TOLERANCE_PPM 500
+#define MAX_LOOP_PERIODS 16
+#define MAX_TABLE_LEN 4096
+
+SysTick_Type mock_systick;
+long millis_start = 0;
+long deep_sleep_time_ms = 0;
+
+struct bake_spec
+{
+	const char * name;
+	style fn;
+	const long * period_ms; // One per LED, or just one shared by all LEDs
+	int per_led;
+};
+
+static const struct bake_spec specs[] = {
+	{ "LEDBeats", LEDBeats, led_pulse_periods_ms, 1 },
+	{ "Breathe", Breathe, &breath_period_ms, 0 },
+};
+#define NUM_SPECS (sizeof(specs)/sizeof(specs[0]))
+
+static uint16_t tables[NUM_LEDS][MAX_TABLE_LEN];
+static int lengths[NUM_LEDS];
+
+static void set_millis( long ms )
+{
+	mock_systick.CNT = ms * DELAY_MS_TIME;
+	millis_start = 0;
+	deep_sleep_time_ms = 0;
+}
+
+// Pick how many wakes (and whole periods) a table for this period should span.
+static int pick_length( long period_ms, int * periods_out )
+{
+	int best_len = 0;
+	int best_periods = 1;
+	double best_err = 1e30;
+	int k;
+	for( k = 1; k <= MAX_LOOP_PERIODS; k++ )
+	{
+		double span = (double)k * period_ms;
+		int len = (int)floor( span / DEEP_SLEEP_TIME_MS + 0.5 );
+		if( len < 1 || len > MAX_TABLE_LEN ) break;
+		double err_ppm = fabs( span - (double)len * DEEP_SLEEP_TIME_MS ) * 1e6 / span;
+		if( err_ppm < best_err )
+		{
+			best_err = err_ppm;
+			best_len = len;
+			best_periods = k;
+		}
+		if( err_ppm <= LOOP_TOLERANCE_PPM ) break;
+	}
+	if( best_err > LOOP_TOLERANCE_PPM )
+		fprintf( stderr, "Warning: %ld ms period loops with %.0f ppm error\n", period_ms, best_err );
+	*periods_out = best_periods;
+	return best_len;
+}
+
+static void emit_table( const char * name, int led, const uint16_t * t, int len )
+{
+	int j;
+	printf( "static const uint16_t %s_%d[%d] = {\n", name, led, len );
+	for( j = 0; j < len; j++ )
+	{
+		if( ( j % 16 ) == 0 ) printf( "\t" );
+		printf( "%4d,%s", t[j], ( ( j % 16 ) == 15 || j == len - 1 ) ? "\n" : " " );
+	}
+	printf( "};\n\n" );
+}
+
+int main()
+{
+	const struct bake_spec * spec = specs;
+	int total_bytes = 0;
+	int s, led, f, j;
+
+	// The tables need every wake, not just the ones the badge wakes up for
+	max_sleep_wakes = 1;
+
+	printf( "// Generated by tools/pattern_compiler.c from patterns.c -- do not edit.\n" );
+	printf( "// Regenerate with: make pattern_tables.c\n\n" );
+	printf( "#include \"patterns.h\"\n\n" );
+
+	for( s = 0; s < NUM_SPECS; s++ )
+	{
+		int alias[NUM_LEDS];
+		int periods[NUM_LEDS];
+		int max_len = 0;
+		for( led = 0; led < NUM_LEDS; led++ )
+		{
+			lengths[led] = pick_length( spec[s].period_ms[spec[s].per_led ? led : 0], &periods[led] );
+			if( lengths[led] > max_len ) max_len = lengths[led];
+		}
+
+		// Run the style exactly like the badge would, one call per wake.
+		reset_patterns();
+		for( f = 0; f < max_len; f++ )
+		{
+			set_millis( (long)f * DEEP_SLEEP_TIME_MS );
+			spec[s].fn();
+			for( led = 0; led < NUM_LEDS; led++ )
+				if( f < lengths[led] ) tables[led][f] = next_pwm_vals[led];
+		}
+
+		for( led = 0; led < NUM_LEDS; led++ )
+		{
+			int len = lengths[led];
+
+			// LEDs that all do the same thing share one table.
+			alias[led] = led;
+			for( j = 0; j < led; j++ )
+			{
+				if( lengths[j] == len && memcmp( tables[j], tables[led], len * sizeof( uint16_t ) ) == 0 )
+				{
+					alias[led] = alias[j];
+					break;
+				}
+			}
+			if( alias[led] != led ) continue;
+
+			printf( "// %s LED %d: %d wakes = %d period(s) of %ld ms\n", spec[s].name, led, len, periods[led], spec[s].period_ms[spec[s].per_led ? led : 0] );
+			emit_table( spec[s].name, led, tables[led], len );
+			total_bytes += len * sizeof( uint16_t );
+			fprintf( stderr, "%s LED %d: %d entries (%d bytes)\n", spec[s].name, led, len, (int)( len * sizeof( uint16_t ) ) );
+		}
+
+		printf( "const struct baked_style baked_%s = {\n\t{", spec[s].name );
+		for( led = 0; led < NUM_LEDS; led++ )
+			printf( " %s_%d%s", spec[s].name, alias[led], ( led == NUM_LEDS - 1 ) ? " " : "," );
+		printf( "},\n\t{" );
+		for( led = 0; led < NUM_LEDS; led++ )
+			printf( " %d%s", lengths[led], ( led == NUM_LEDS - 1 ) ? " " : "," );
+		printf( "},\n};\n\n" );
+		printf( "uint8_t %s_baked() { return play_baked( &baked_%s ); }\n\n", spec[s].name, spec[s].name );
+	}
+
+	fprintf( stderr, "Total: %d bytes of flash\n", total_bytes );
+	return 0;
+}
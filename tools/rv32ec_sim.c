@@ -0,0 +1,335 @@
+// Tiny RV32EC instruction set simulator for benchmarking badge code on a PC.
+//
+// Loads a flat CH32V003 flash image at 0x00000000 and runs it from reset, with
+// 2 kB of RAM and just enough of the peripherals modelled for SystemInit(),
+// SysTick and TIM1's one-pulse mode to behave. Everything else in peripheral
+// space is plain memory.
+//
+// The program talks to the simulator with ecall (see bench/sim.h), marking the
+// regions it wants counted. For each region name the simulator reports the
+// number of times it ran, and the instructions and cycles it took on average
+// and at worst.
+//
+// The cycle model is an approximation of the QingKe V2A core: one cycle per
+// instruction, plus one for loads and stores, plus two for taken branches and
+// jumps, plus the flash wait states (-w) for every instruction fetch and data
+// read from flash. Divides and multiplies come from libgcc, so they are
+// counted instruction by instruction, just like on the chip.
+//
+// Usage: rv32ec_sim [-c] [-w wait_states] [-m max_instructions] image.bin
+//   -c  print results as CSV
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bench/sim.h"
+
+#define FLASH_BASE  0x00000000
+#define FLASH_ALIAS 0x08000000
+#define FLASH_SIZE  (16*1024)
+#define RAM_BASE    0x20000000
+#define RAM_SIZE    (2*1024)
+#define PERIPH_BASE 0x40000000
+#define PERIPH_SIZE 0x24000
+#define CORE_BASE   0xE0000000
+#define CORE_SIZE   0x10000
+
+#define SYSTICK_CTLR 0xE000F000
+#define SYSTICK_CNT  0xE000F008
+#define RCC_CTLR     0x40021000
+#define RCC_CFGR0    0x40021004
+#define RCC_RSTSCKR  0x40021024
+#define TIM1_CTLR1   0x40012C00
+#define TIM1_PSC     0x40012C28
+#define TIM1_ATRLR   0x40012C2C
+
+#define MAX_REGIONS 32
+
+struct region
+{
+	char name[32];
+	uint64_t runs;
+	uint64_t instructions;
+	uint64_t cycles;
+	uint64_t max_cycles;
+};
+
+static uint8_t flash[FLASH_SIZE];
+static uint8_t ram[RAM_SIZE];
+static uint8_t periph[PERIPH_SIZE];
+static uint8_t core[CORE_SIZE];
+
+static uint32_t regs[16];
+static uint32_t pc;
+static uint32_t csrs[4096];
+static uint64_t instructions;
+static uint64_t cycles;
+static int wait_states = 1;
+
+static uint64_t tim1_start;
+
+static struct region regions[MAX_REGIONS];
+static int num_regions;
+static struct region * current_region;
+static uint64_t region_start_instructions;
+static uint64_t region_start_cycles;
+
+static void fault( const char * why, uint32_t addr )
+{
+	fprintf( stderr, "Error: %s at 0x%08x (pc = 0x%08x, %llu instructions in)\n", why, addr, pc, (unsigned long long)instructions );
+	exit( -1 );
+}
+
+static int in_flash( uint32_t addr )
+{
+	return addr < FLASH_BASE + FLASH_SIZE || ( addr >= FLASH_ALIAS && addr < FLASH_ALIAS + FLASH_SIZE );
+}
+
+static uint8_t * memory( uint32_t addr, int len, int write )
+{
+	if( addr >= FLASH_ALIAS && addr + len <= FLASH_ALIAS + FLASH_SIZE ) addr -= FLASH_ALIAS;
+	if( addr + len <= FLASH_BASE + FLASH_SIZE )
+	{
+		if( write ) fault( "Write to flash", addr );
+		return flash + addr - FLASH_BASE;
+	}
+	if( addr >= RAM_BASE && addr + len <= RAM_BASE + RAM_SIZE ) return ram + addr - RAM_BASE;
+	if( addr >= PERIPH_BASE && addr + len <= PERIPH_BASE + PERIPH_SIZE ) return periph + addr - PERIPH_BASE;
+	if( addr >= CORE_BASE && addr + len <= CORE_BASE + CORE_SIZE ) return core + addr - CORE_BASE;
+	fault( write ? "Bad write" : "Bad read", addr );
+	return 0;
+}
+
+static uint32_t peek32( uint32_t addr )
+{
+	uint32_t v;
+	memcpy( &v, memory( addr, 4, 0 ), 4 );
+	return v;
+}
+
+static void poke32( uint32_t addr, uint32_t v )
+{
+	memcpy( memory( addr, 4, 1 ), &v, 4 );
+}
+
+// Registers that change by themselves.
+static void update_read( uint32_t addr )
+{
+	switch( addr & ~3 )
+	{
+	case SYSTICK_CNT:
+		// HCLK or HCLK/8, depending on SysTick->CTLR
+		poke32( SYSTICK_CNT, ( peek32( SYSTICK_CTLR ) & 4 ) ? (uint32_t)cycles : (uint32_t)( cycles / 8 ) );
+		break;
+	case TIM1_CTLR1:
+	{
+		// One-pulse mode: the counter stops itself after one period.
+		uint32_t ctlr = peek32( TIM1_CTLR1 );
+		uint64_t period = (uint64_t)( ( peek32( TIM1_PSC ) & 0xffff ) + 1 ) * ( ( peek32( TIM1_ATRLR ) & 0xffff ) + 1 );
+		if( ( ctlr & 9 ) == 9 && cycles - tim1_start >= period )
+			poke32( TIM1_CTLR1, ctlr & ~1 );
+		break;
+	}
+	}
+}
+
+// Registers with side effects on write. Clocks and oscillators are ready as
+// soon as they are turned on.
+static void update_write( uint32_t addr, uint32_t before )
+{
+	uint32_t v;
+	switch( addr & ~3 )
+	{
+	case RCC_CTLR:
+		v = peek32( RCC_CTLR ) & ~( ( 1 << 1 ) | ( 1 << 17 ) | ( 1 << 25 ) );
+		poke32( RCC_CTLR, v | ( ( v & 1 ) << 1 ) | ( ( v & ( 1 << 16 ) ) << 1 ) | ( ( v & ( 1 << 24 ) ) << 1 ) );
+		break;
+	case RCC_CFGR0:
+		v = peek32( RCC_CFGR0 ) & ~0xc;
+		poke32( RCC_CFGR0, v | ( ( v & 3 ) << 2 ) );
+		break;
+	case RCC_RSTSCKR:
+		v = peek32( RCC_RSTSCKR ) & ~2;
+		poke32( RCC_RSTSCKR, v | ( ( v & 1 ) << 1 ) );
+		break;
+	case TIM1_CTLR1:
+		if( !( before & 1 ) && ( peek32( TIM1_CTLR1 ) & 1 ) ) tim1_start = cycles;
+		break;
+	}
+}
+
+static struct region * find_region( uint32_t name_addr )
+{
+	char name[32];
+	int i;
+	for( i = 0; i < (int)sizeof( name ) - 1; i++ )
+	{
+		name[i] = *memory( name_addr + i, 1, 0 );
+		if( !name[i] ) break;
+	}
+	name[i] = 0;
+	for( i = 0; i < num_regions; i++ )
+		if( strcmp( regions[i].name, name ) == 0 ) return &regions[i];
+	if( num_regions == MAX_REGIONS ) fault( "Too many regions", name_addr );
+	strcpy( regions[num_regions].name, name );
+	return &regions[num_regions++];
+}
+
+// Returns nonzero when the program asks to exit.
+static int sim_call()
+{
+	switch( regs[10] )
+	{
+	case SIM_EXIT:
+		return 1;
+	case SIM_BEGIN:
+		current_region = find_region( regs[11] );
+		region_start_instructions = instructions;
+		region_start_cycles = cycles;
+		break;
+	case SIM_END:
+		if( current_region )
+		{
+			uint64_t c = cycles - region_start_cycles;
+			current_region->runs++;
+			current_region->instructions += instructions - region_start_instructions;
+			current_region->cycles += c;
+			if( c > current_region->max_cycles ) current_region->max_cycles = c;
+			current_region = 0;
+		}
+		break;
+	default:
+		fault( "Unknown sim call", regs[10] );
+	}
+	return 0;
+}
+
+// Hooks for the shared decoder. Instruction fetches from flash pay their wait
+// states in step().
+static int fetch( uint32_t addr, uint32_t * v )
+{
+	*v = *(uint16_t *)memory( addr, 2, 0 );
+	return 0;
+}
+
+static int load( uint32_t addr, int len, uint32_t * v )
+{
+	update_read( addr );
+	memcpy( v, memory( addr, len, 0 ), len );
+	if( in_flash( addr ) ) cycles += wait_states;
+	return 0;
+}
+
+static int store( uint32_t addr, int len, uint32_t v )
+{
+	uint32_t before = ( ( addr & ~3 ) >= PERIPH_BASE ) ? peek32( addr & ~3 ) : 0;
+	memcpy( memory( addr, len, 1 ), &v, len );
+	update_write( addr, before );
+	return 0;
+}
+
+
+// ecall, mret, wfi and the CSR instructions. Returns nonzero when the program
+// asks to exit.
+static int system_op( uint32_t ir, uint32_t * next, uint32_t * rd )
+{
+	uint32_t csr = ir >> 20;
+	uint32_t f3 = ( ir >> 12 ) & 7;
+	uint32_t src = ( f3 & 4 ) ? ( ( ir >> 15 ) & 0x1f ) : regs[( ir >> 15 ) & 0xf];
+	uint32_t old;
+	if( f3 == 0 )
+	{
+		if( ir == 0x00000073 ) return sim_call(); // ecall
+		else if( ir == 0x30200073 ) *next = csrs[0x341]; // mret
+		else if( ir == 0x10500073 ) {} // wfi, wakes up straight away
+		else fault( "Unsupported system instruction", ir );
+		return 0;
+	}
+	old = csrs[csr];
+	switch( f3 & 3 )
+	{
+	case 1: csrs[csr] = src; break;
+	case 2: csrs[csr] = old | src; break;
+	case 3: csrs[csr] = old & ~src; break;
+	}
+	*rd = old;
+	return 0;
+}
+
+#define RV32EC_CTX int
+#define RV32EC_REG( c, n ) regs[n]
+#define RV32EC_PC( c ) pc
+#define RV32EC_CYCLES( c ) cycles
+#define RV32EC_FETCH( c, addr, v ) fetch( addr, v )
+#define RV32EC_LOAD( c, addr, len, v ) load( addr, len, v )
+#define RV32EC_STORE( c, addr, len, v ) store( addr, len, v )
+#define RV32EC_SYSTEM( c, ir, next, v ) system_op( ir, next, v )
+#include "../ch32v003fun/minichlink/rv32ec.h"
+
+// Run one instruction. Returns nonzero when the program asks to exit.
+static int step()
+{
+	int r;
+	if( in_flash( pc ) ) cycles += wait_states;
+	instructions++;
+	r = RV32ECStep( 0 );
+	if( r == RV32EC_ILLEGAL ) fault( "Illegal instruction", pc );
+	return r;
+}
+
+int main( int argc, char ** argv )
+{
+	const char * image = 0;
+	uint64_t max_instructions = 1000000000ULL;
+	int csv = 0;
+	int i;
+	FILE * f;
+
+	for( i = 1; i < argc; i++ )
+	{
+		if( strcmp( argv[i], "-c" ) == 0 ) csv = 1;
+		else if( strcmp( argv[i], "-w" ) == 0 && i + 1 < argc ) wait_states = atoi( argv[++i] );
+		else if( strcmp( argv[i], "-m" ) == 0 && i + 1 < argc ) max_instructions = strtoull( argv[++i], 0, 0 );
+		else image = argv[i];
+	}
+	if( !image )
+	{
+		fprintf( stderr, "Usage: %s [-c] [-w wait_states] [-m max_instructions] image.bin\n", argv[0] );
+		return -1;
+	}
+
+	f = fopen( image, "rb" );
+	if( !f )
+	{
+		fprintf( stderr, "Error: Could not open %s\n", image );
+		return -1;
+	}
+	if( fread( flash, 1, FLASH_SIZE, f ) == 0 )
+	{
+		fprintf( stderr, "Error: %s is empty\n", image );
+		return -1;
+	}
+	fclose( f );
+
+	pc = FLASH_BASE;
+	while( !step() )
+	{
+		if( instructions >= max_instructions )
+			fault( "Instruction limit reached", max_instructions );
+	}
+
+	if( csv )
+		printf( "region,runs,instructions,cycles,max_cycles\n" );
+	else
+		printf( "%-20s %8s %14s %14s %12s\n", "region", "runs", "instr/run", "cycles/run", "max cycles" );
+	for( i = 0; i < num_regions; i++ )
+	{
+		struct region * r = &regions[i];
+		double runs = r->runs ? r->runs : 1;
+		printf( csv ? "%s,%llu,%.1f,%.1f,%llu\n" : "%-20s %8llu %14.1f %14.1f %12llu\n", r->name, (unsigned long long)r->runs,
+			r->instructions / runs, r->cycles / runs, (unsigned long long)r->max_cycles );
+	}
+	return regs[11];
+}
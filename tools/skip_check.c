@@ -0,0 +1,124 @@
+// Checks that sleeping through dark wakes doesn't change what the LEDs show.
+//
+// Runs every style in style_list.h the way the main loop in tim1_pwm.c does:
+// once with max_sleep_wakes = 1, so it's called every wake, and once letting
+// it sleep for up to MAX_SLEEP_WAKES. What a style fills in is shown after the
+// sleep it asks for, and the wakes slept through are dark. Both runs have to
+// show the same thing on every wake, at a few different wake_scales.
+//
+// Prints the first wake that differs for each style, and the exit code is
+// nonzero if there was one.
+//
+// Usage: skip_check [wakes]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../patterns.c"
+#include "../cie_tables.c"
+#include "../pattern_tables.c"
+#include "../vm.c"
+#include "../vm_programs.c"
+#include "../random_styles.c"
+
+#define MAX_CHECK_WAKES 100000
+
+SysTick_Type mock_systick;
+long millis_start = 0;
+long deep_sleep_time_ms = 0;
+
+struct named_style
+{
+	const char * name;
+	style fn;
+};
+
+static const struct named_style all_styles[] = {
+#define STYLE( fn ) { #fn, fn },
+#include "style_list.h"
+#undef STYLE
+};
+#define NUM_ALL_STYLES (sizeof(all_styles)/sizeof(all_styles[0]))
+
+// Calibrated wakes come out a bit long or short
+static const uint32_t scales[] = { WAKE_SCALE_ONE, WAKE_SCALE_ONE * 9 / 10, WAKE_SCALE_ONE * 11 / 10 };
+
+static uint16_t every_wake[MAX_CHECK_WAKES][NUM_LEDS];
+static uint16_t skipping[MAX_CHECK_WAKES][NUM_LEDS];
+
+// Starts everything over, including the random styles, which the badge never
+// needs to.
+static void restart( uint32_t scale )
+{
+	reset_patterns();
+	vm_reset();
+	rng_seed( 0 );
+	memset( candle_level, 0, sizeof( candle_level ) );
+	memset( sparkle_level, 0, sizeof( sparkle_level ) );
+	sparkle_led = 0;
+	sparkle_gap = 0;
+	wake_scale = scale;
+}
+
+// Fills in what the LEDs show on each wake. Returns 0 if the style asked for
+// a sleep it isn't allowed.
+static int run( style fn, uint8_t max_wakes, uint16_t ( *shown )[NUM_LEDS], int wakes )
+{
+	int w = 0;
+	uint8_t n;
+	memset( shown, 0, sizeof( *shown ) * wakes );
+	while( w < wakes )
+	{
+		mock_systick.CNT = 0;
+		deep_sleep_time_ms = (long)w * DEEP_SLEEP_TIME_MS;
+		max_sleep_wakes = max_wakes;
+		n = fn();
+		if( n < 1 || n > max_wakes ) return 0;
+		w += n;
+		if( w < wakes ) memcpy( shown[w], next_pwm_vals, sizeof( next_pwm_vals ) );
+	}
+	return 1;
+}
+
+int main( int argc, char ** argv )
+{
+	int wakes = ( argc > 1 ) ? atoi( argv[1] ) : 20000;
+	int bad = 0;
+	int s, c, w, led;
+
+	if( wakes < 1 || wakes > MAX_CHECK_WAKES )
+	{
+		fprintf( stderr, "Usage: %s [wakes, up to %d]\n", argv[0], MAX_CHECK_WAKES );
+		return -1;
+	}
+
+	for( s = 0; s < NUM_ALL_STYLES; s++ )
+	{
+		for( c = 0; c < sizeof( scales ) / sizeof( scales[0] ); c++ )
+		{
+			double scale = (double)scales[c] / WAKE_SCALE_ONE;
+			restart( scales[c] );
+			run( all_styles[s].fn, 1, every_wake, wakes );
+			restart( scales[c] );
+			if( !run( all_styles[s].fn, MAX_SLEEP_WAKES, skipping, wakes ) )
+			{
+				printf( "%-16s scale %.2f: asked to sleep for 0 wakes, or more than %d\n", all_styles[s].name, scale, MAX_SLEEP_WAKES );
+				bad = 1;
+				continue;
+			}
+			for( w = 0; w < wakes; w++ )
+			{
+				if( memcmp( every_wake[w], skipping[w], sizeof( every_wake[w] ) ) == 0 ) continue;
+				for( led = 0; led < NUM_LEDS && every_wake[w][led] == skipping[w][led]; led++ );
+				printf( "%-16s scale %.2f: wake %d, LED %d shows %d instead of %d\n", all_styles[s].name, scale,
+					w, led, skipping[w][led], every_wake[w][led] );
+				bad = 1;
+				break;
+			}
+			if( w == wakes )
+				printf( "%-16s scale %.2f: ok\n", all_styles[s].name, scale );
+		}
+	}
+	return bad;
+}
@@ -0,0 +1,14 @@
+// Every style the host tools know about, as an X-macro list. Define
+// STYLE( fn ) before including this. Add new styles here.
+
+STYLE( LEDBeatsMillis )
+STYLE( LEDBeats )
+STYLE( LEDBeats_baked )
+STYLE( LEDBeats_vm )
+STYLE( BreatheMillis )
+STYLE( Breathe )
+STYLE( Breathe_baked )
+STYLE( Breathe_vm )
+STYLE( Chase_vm )
+STYLE( Candle )
+STYLE( Sparkle )
@@ -0,0 +1,510 @@
+// Compiler for the pattern language, see vm.h for the VM it targets.
+//
+// A source file holds one or more styles. One statement per line, # starts a
+// comment:
+//
+//   style NAME              Start a style, NAME_vm() in vm_programs.c
+//   var x [= CONST]         A 32-bit variable, kept between wakes. 0 if no value
+//   x = A                   Where A is a variable or a constant
+//   x = A + B               Also -, and << or >> by a constant
+//   x += A                  Also -=
+//   x = f(A[, B])           f is one of:
+//                             saw(A)      top 8 bits of A, 0 to 255
+//                             tri(A)      0 up to 255 and back over A's range
+//                             cie(A)      brightness for lightness A (0-255)
+//                             scale(A, B) A * B / 256, B from 0 to 256
+//                             min(A, B), max(A, B)
+//   led N = A               Brightness of LED N, 0 to MAX_FINE_PWM_VAL
+//   if A < B                Also <=, >, >=
+//   else
+//   end
+//
+// Everything after the var lines runs once per wake, top to bottom. There are
+// no loops, so a wake costs at most the number of instructions in the style.
+// The compiler prints that number for each style.
+//
+// Constants are 32-bit integers (decimal or 0x hex), or period(MS), the amount
+// a phase variable has to go up by every wake to wrap around once every MS
+// milliseconds (MS can have a fraction). saw() and tri() of a phase variable
+// then give a wave with that period.
+//
+// Usage: vm_compiler vm_styles.pat > vm_programs.c
+//        vm_compiler -b NAME vm_styles.pat > NAME.vmb
+//
+// -b writes just the one style, as a struct vm_image for make upload.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "../patterns.h"
+#include "../vm.h"
+
+#define MAX_CODE 255
+#define MAX_STYLES 16
+#define MAX_NAME 32
+#define MAX_TOKENS 16
+#define MAX_DEPTH 8
+
+// Variables count up from r0, constants are loaded into the top two registers
+#define MAX_VARS ( VM_REGS - 2 )
+#define SCRATCH_A ( VM_REGS - 1 )
+#define SCRATCH_B ( VM_REGS - 2 )
+
+static const char * file_name;
+static int line_no;
+
+static char style_name[MAX_NAME];
+static char var_names[MAX_VARS][MAX_NAME];
+static int num_vars;
+static struct vm_insn init_code[MAX_CODE];
+static int init_length;
+static struct vm_insn code[MAX_CODE];
+static int length;
+
+// Open ifs, where the branch (or else's jump) to patch is
+static int if_stack[MAX_DEPTH];
+static int if_depth;
+
+static char style_names[MAX_STYLES][MAX_NAME];
+static int num_styles;
+
+static const char * op_names[NUM_VM_OPS] = {
+	"VM_END", "VM_LDI", "VM_LDIH", "VM_MOV", "VM_ADD", "VM_SUB", "VM_SHL", "VM_SHR", "VM_SCALE",
+	"VM_MIN", "VM_MAX", "VM_SAW", "VM_TRI", "VM_CIE", "VM_OUT", "VM_BLT", "VM_BGE", "VM_JMP",
+};
+
+static char tokens[MAX_TOKENS][MAX_NAME];
+static int num_tokens;
+
+// With -b, the style to write out as an image, and whether it was found
+static const char * image_style;
+static int image_written;
+
+static void fail( const char * msg, const char * what )
+{
+	fprintf( stderr, "%s:%d: %s%s%s\n", file_name, line_no, msg, what ? ": " : "", what ? what : "" );
+	exit( 1 );
+}
+
+static void tokenize( const char * line )
+{
+	const char * p = line;
+	num_tokens = 0;
+	while( *p && *p != '#' && *p != '\n' )
+	{
+		int n = 0;
+		if( isspace( (unsigned char)*p ) )
+		{
+			p++;
+			continue;
+		}
+		if( num_tokens == MAX_TOKENS ) fail( "Line too long", 0 );
+		if( isalnum( (unsigned char)*p ) || *p == '_' || *p == '.' )
+		{
+			while( ( isalnum( (unsigned char)p[n] ) || p[n] == '_' || p[n] == '.' ) && n < MAX_NAME - 1 ) n++;
+		}
+		else if( ( p[0] == '<' && p[1] == '<' ) || ( p[0] == '>' && p[1] == '>' ) ||
+			( ( p[0] == '<' || p[0] == '>' || p[0] == '+' || p[0] == '-' ) && p[1] == '=' ) )
+		{
+			n = 2;
+		}
+		else if( strchr( "=+-<>(),", *p ) )
+		{
+			n = 1;
+		}
+		else
+		{
+			char bad[2] = { *p, 0 };
+			fail( "Unexpected character", bad );
+		}
+		memcpy( tokens[num_tokens], p, n );
+		tokens[num_tokens][n] = 0;
+		num_tokens++;
+		p += n;
+	}
+}
+
+static int is_token( int t, const char * s )
+{
+	return t < num_tokens && strcmp( tokens[t], s ) == 0;
+}
+
+static void expect( int t, const char * s )
+{
+	if( !is_token( t, s ) ) fail( "Expected", s );
+}
+
+static int find_var( const char * name )
+{
+	int v;
+	for( v = 0; v < num_vars; v++ )
+		if( strcmp( var_names[v], name ) == 0 ) return v;
+	return -1;
+}
+
+static void emit_to( struct vm_insn * c, int * len, int op, int a, int b, int cc )
+{
+	if( *len == MAX_CODE ) fail( "Style is too long", style_name );
+	c[*len].op = op;
+	c[*len].a = a;
+	c[*len].b = b;
+	c[*len].c = cc;
+	( *len )++;
+}
+
+static void emit( int op, int a, int b, int c )
+{
+	emit_to( code, &length, op, a, b, c );
+}
+
+// Load a 32-bit constant, in one instruction if it fits in 16 bits
+static void emit_const( struct vm_insn * c, int * len, int reg, int32_t value )
+{
+	emit_to( c, len, VM_LDI, reg, value & 0xff, ( value >> 8 ) & 0xff );
+	if( value != (int16_t)value )
+		emit_to( c, len, VM_LDIH, reg, ( value >> 16 ) & 0xff, ( value >> 24 ) & 0xff );
+}
+
+// A constant operand starting at token t. Returns the tokens it used, 0 if
+// it isn't a constant.
+static int parse_const( int t, int32_t * value )
+{
+	int neg = 0;
+	int used = 0;
+	char * end;
+	if( is_token( t, "-" ) )
+	{
+		neg = 1;
+		t++;
+		used++;
+	}
+	if( t >= num_tokens ) return 0;
+	if( strcmp( tokens[t], "period" ) == 0 )
+	{
+		double ms;
+		expect( t + 1, "(" );
+		expect( t + 3, ")" );
+		ms = strtod( tokens[t + 2], &end );
+		if( *end || ms < DEEP_SLEEP_TIME_MS ) fail( "Bad period", tokens[t + 2] );
+		*value = (int32_t)(uint32_t)( 4294967296.0 * DEEP_SLEEP_TIME_MS / ms );
+		used += 4;
+	}
+	else if( isdigit( (unsigned char)tokens[t][0] ) )
+	{
+		long long v = strtoll( tokens[t], &end, 0 );
+		if( *end || v > 0xffffffffLL ) fail( "Bad number", tokens[t] );
+		*value = (int32_t)(uint32_t)v;
+		used++;
+	}
+	else
+	{
+		return 0;
+	}
+	if( neg ) *value = -*value;
+	return used;
+}
+
+// An operand (variable or constant) starting at *t, as a register. Constants
+// are loaded into scratch.
+static int operand( int * t, int scratch )
+{
+	int32_t value;
+	int used = parse_const( *t, &value );
+	int v;
+	if( used )
+	{
+		emit_const( code, &length, scratch, value );
+		*t += used;
+		return scratch;
+	}
+	if( *t >= num_tokens ) fail( "Expected a variable or constant", 0 );
+	v = find_var( tokens[*t] );
+	if( v < 0 ) fail( "Unknown variable", tokens[*t] );
+	( *t )++;
+	return v;
+}
+
+static void end_of_line( int t )
+{
+	if( t < num_tokens ) fail( "Unexpected", tokens[t] );
+}
+
+static void write_image( )
+{
+	struct vm_image img = { VM_IMAGE_MAGIC, init_length, length, 0 };
+	fwrite( &img, sizeof( img ), 1, stdout );
+	fwrite( init_code, sizeof( struct vm_insn ), init_length, stdout );
+	fwrite( code, sizeof( struct vm_insn ), length, stdout );
+	image_written = 1;
+}
+
+static void finish_style( )
+{
+	int i;
+	if( !style_name[0] ) return;
+	if( if_depth ) fail( "Missing end in style", style_name );
+
+	if( image_style )
+	{
+		if( strcmp( style_name, image_style ) == 0 ) write_image( );
+		style_name[0] = 0;
+		return;
+	}
+
+	printf( "// %s: %d init instructions, at most %d per wake\n", style_name, init_length, length );
+	printf( "static const struct vm_insn %s_code[%d] = {\n", style_name, init_length + length );
+	for( i = 0; i < init_length + length; i++ )
+	{
+		const struct vm_insn * in = ( i < init_length ) ? &init_code[i] : &code[i - init_length];
+		char op[16];
+		snprintf( op, sizeof( op ), "%s,", op_names[in->op] );
+		printf( "\t{ %-9s %3d, %3d, %3d },\n", op, in->a, in->b, in->c );
+	}
+	printf( "};\n\n" );
+	printf( "static struct vm_state %s_state;\n\n", style_name );
+	printf( "const struct vm_program vm_%s = { %s_code, &%s_state, %d, %d };\n\n", style_name, style_name, style_name, init_length, length );
+	printf( "uint8_t %s_vm() { return vm_run( &vm_%s ); }\n\n", style_name, style_name );
+	fprintf( stderr, "%s: %d bytes, at most %d instructions per wake\n", style_name, ( init_length + length ) * 4, length );
+
+	style_name[0] = 0;
+}
+
+static void start_style( const char * name )
+{
+	int s;
+	finish_style( );
+	for( s = 0; s < num_styles; s++ )
+		if( strcmp( style_names[s], name ) == 0 ) fail( "Style defined twice", name );
+	if( num_styles == MAX_STYLES ) fail( "Too many styles", 0 );
+	strcpy( style_names[num_styles++], name );
+	strcpy( style_name, name );
+	num_vars = 0;
+	init_length = 0;
+	length = 0;
+	if_depth = 0;
+}
+
+// Patch the branch at index 'from' to land on the current end of the code
+static void patch( int from )
+{
+	int skip = length - from - 1;
+	if( skip > 255 ) fail( "Block is too long", 0 );
+	code[from].a = skip;
+}
+
+static void compile_if( )
+{
+	int t = 1;
+	int ra, rb;
+	const char * cmp;
+	ra = operand( &t, SCRATCH_A );
+	if( t >= num_tokens ) fail( "Expected a comparison", 0 );
+	cmp = tokens[t++];
+	rb = operand( &t, SCRATCH_B );
+	end_of_line( t );
+	if( if_depth == MAX_DEPTH ) fail( "Ifs nested too deep", 0 );
+
+	// Branch over the block when the condition is false
+	if( strcmp( cmp, "<" ) == 0 )       emit( VM_BGE, 0, ra, rb );
+	else if( strcmp( cmp, ">=" ) == 0 ) emit( VM_BLT, 0, ra, rb );
+	else if( strcmp( cmp, ">" ) == 0 )  emit( VM_BGE, 0, rb, ra );
+	else if( strcmp( cmp, "<=" ) == 0 ) emit( VM_BLT, 0, rb, ra );
+	else fail( "Unknown comparison", cmp );
+	if_stack[if_depth++] = length - 1;
+}
+
+static void compile_assign( )
+{
+	int dst = find_var( tokens[0] );
+	int t = 2;
+	int ra, rb;
+	int32_t value;
+	if( dst < 0 ) fail( "Unknown variable", tokens[0] );
+
+	if( is_token( 1, "+=" ) || is_token( 1, "-=" ) )
+	{
+		rb = operand( &t, SCRATCH_A );
+		end_of_line( t );
+		emit( is_token( 1, "+=" ) ? VM_ADD : VM_SUB, dst, dst, rb );
+		return;
+	}
+	expect( 1, "=" );
+
+	if( t + 1 < num_tokens && is_token( t + 1, "(" ) && strcmp( tokens[t], "period" ) )
+	{
+		static const struct { const char * name; int op; int args; } funcs[] = {
+			{ "saw", VM_SAW, 1 }, { "tri", VM_TRI, 1 }, { "cie", VM_CIE, 1 },
+			{ "scale", VM_SCALE, 2 }, { "min", VM_MIN, 2 }, { "max", VM_MAX, 2 },
+		};
+		int f;
+		for( f = 0; f < sizeof( funcs ) / sizeof( funcs[0] ); f++ )
+			if( strcmp( tokens[t], funcs[f].name ) == 0 ) break;
+		if( f == sizeof( funcs ) / sizeof( funcs[0] ) ) fail( "Unknown function", tokens[t] );
+		t += 2;
+		ra = operand( &t, SCRATCH_A );
+		rb = 0;
+		if( funcs[f].args == 2 )
+		{
+			expect( t++, "," );
+			rb = operand( &t, SCRATCH_B );
+		}
+		expect( t++, ")" );
+		end_of_line( t );
+		emit( funcs[f].op, dst, ra, rb );
+		return;
+	}
+
+	// A plain constant goes straight into the variable
+	if( parse_const( t, &value ) && parse_const( t, &value ) + t == num_tokens )
+	{
+		emit_const( code, &length, dst, value );
+		return;
+	}
+
+	ra = operand( &t, SCRATCH_A );
+	if( t == num_tokens )
+	{
+		if( ra != dst ) emit( VM_MOV, dst, ra, 0 );
+		return;
+	}
+	if( is_token( t, "<<" ) || is_token( t, ">>" ) )
+	{
+		int op = is_token( t, "<<" ) ? VM_SHL : VM_SHR;
+		t++;
+		if( !parse_const( t, &value ) || value < 0 || value > 31 ) fail( "Shifts need a constant from 0 to 31", 0 );
+		t += parse_const( t, &value );
+		end_of_line( t );
+		emit( op, dst, ra, value );
+		return;
+	}
+	if( is_token( t, "+" ) || is_token( t, "-" ) )
+	{
+		int op = is_token( t, "+" ) ? VM_ADD : VM_SUB;
+		t++;
+		rb = operand( &t, SCRATCH_B );
+		end_of_line( t );
+		emit( op, dst, ra, rb );
+		return;
+	}
+	fail( "Unexpected", tokens[t] );
+}
+
+static void compile_line( )
+{
+	if( num_tokens == 0 ) return;
+
+	if( is_token( 0, "style" ) )
+	{
+		if( num_tokens != 2 || !( isalpha( (unsigned char)tokens[1][0] ) || tokens[1][0] == '_' ) ) fail( "Expected style NAME", 0 );
+		start_style( tokens[1] );
+		return;
+	}
+	if( !style_name[0] ) fail( "Expected style NAME first", 0 );
+
+	if( is_token( 0, "var" ) )
+	{
+		int32_t value = 0;
+		if( num_tokens < 2 || !( isalpha( (unsigned char)tokens[1][0] ) || tokens[1][0] == '_' ) ) fail( "Expected var NAME", 0 );
+		if( length ) fail( "Variables must come before the code", tokens[1] );
+		if( find_var( tokens[1] ) >= 0 ) fail( "Variable defined twice", tokens[1] );
+		if( num_vars == MAX_VARS ) fail( "Too many variables", tokens[1] );
+		if( num_tokens > 2 )
+		{
+			expect( 2, "=" );
+			if( parse_const( 3, &value ) + 3 != num_tokens ) fail( "Variables start at a constant", tokens[1] );
+		}
+		strcpy( var_names[num_vars], tokens[1] );
+		if( value ) emit_const( init_code, &init_length, num_vars, value );
+		num_vars++;
+		return;
+	}
+	if( is_token( 0, "led" ) )
+	{
+		int t = 3;
+		int led, r;
+		if( num_tokens < 4 || !isdigit( (unsigned char)tokens[1][0] ) ) fail( "Expected led N = value", 0 );
+		led = atoi( tokens[1] );
+		if( led >= NUM_LEDS ) fail( "No such LED", tokens[1] );
+		expect( 2, "=" );
+		r = operand( &t, SCRATCH_A );
+		end_of_line( t );
+		emit( VM_OUT, led, r, 0 );
+		return;
+	}
+	if( is_token( 0, "if" ) )
+	{
+		compile_if( );
+		return;
+	}
+	if( is_token( 0, "else" ) )
+	{
+		end_of_line( 1 );
+		if( !if_depth ) fail( "else without if", 0 );
+		emit( VM_JMP, 0, 0, 0 );
+		patch( if_stack[if_depth - 1] );
+		if_stack[if_depth - 1] = length - 1;
+		return;
+	}
+	if( is_token( 0, "end" ) )
+	{
+		end_of_line( 1 );
+		if( !if_depth ) fail( "end without if", 0 );
+		patch( if_stack[--if_depth] );
+		return;
+	}
+	if( num_tokens >= 2 && ( is_token( 1, "=" ) || is_token( 1, "+=" ) || is_token( 1, "-=" ) ) )
+	{
+		compile_assign( );
+		return;
+	}
+	fail( "Unexpected", tokens[0] );
+}
+
+int main( int argc, char ** argv )
+{
+	char line[256];
+	FILE * f;
+	if( argc == 4 && strcmp( argv[1], "-b" ) == 0 )
+	{
+		image_style = argv[2];
+		argv += 2;
+		argc -= 2;
+	}
+	if( argc != 2 )
+	{
+		fprintf( stderr, "Usage: vm_compiler [-b NAME] vm_styles.pat > vm_programs.c\n" );
+		return 1;
+	}
+	file_name = argv[1];
+	f = fopen( file_name, "r" );
+	if( !f )
+	{
+		fprintf( stderr, "Error: Could not open %s\n", file_name );
+		return 1;
+	}
+
+	if( !image_style )
+	{
+		printf( "// Generated by tools/vm_compiler.c from %s -- do not edit.\n", file_name );
+		printf( "// Regenerate with: make vm_programs.c\n\n" );
+		printf( "#include \"vm.h\"\n\n" );
+	}
+
+	while( fgets( line, sizeof( line ), f ) )
+	{
+		line_no++;
+		tokenize( line );
+		compile_line( );
+	}
+	fclose( f );
+	finish_style( );
+	if( image_style && !image_written )
+	{
+		fprintf( stderr, "Error: No style %s in %s\n", image_style, file_name );
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,119 @@
+/*
+ * Uploaded styles, see upload.h. The transfer itself is
+ * extralibs/swio_upload.h, this decides where the bytes go.
+ *
+ * The slot is written a page at a time as the data comes in, and only looked
+ * at again once the whole file has arrived. A failed upload erases the first
+ * page, so a half-written program is never run.
+ */
+
+#include "ch32v003fun.h"
+#include "patterns.h"
+#include "vm.h"
+#include "flash.h"
+#include "upload.h"
+
+#define SWIO_UPLOAD_IMPLEMENTATION
+#include "swio_upload.h"
+
+const uint32_t upload_slot[UPLOAD_SLOT_BYTES / 4] __attribute__((aligned(64))) = {
+	[0 ... UPLOAD_SLOT_BYTES / 4 - 1] = 0xffffffff
+};
+
+static uint32_t page_buf[FLASH_PAGE_WORDS];
+static uint32_t upload_length;
+
+static struct vm_state custom_state;
+static struct vm_program custom_program;
+
+void upload_init() {
+	// Read through a volatile pointer, the compiler thinks upload_slot is all 1s
+	const volatile struct vm_image * img = (const volatile struct vm_image *)upload_slot;
+	uint16_t insns = img->init_length + img->length;
+
+	custom_program.code = 0;
+	if (img->magic != VM_IMAGE_MAGIC || sizeof(struct vm_image) + insns * sizeof(struct vm_insn) > UPLOAD_SLOT_BYTES) {
+		return;
+	}
+	custom_program.code = (const struct vm_insn *)(img + 1);
+	custom_program.state = &custom_state;
+	custom_program.init_length = img->init_length;
+	custom_program.length = img->length;
+	if (!vm_check(&custom_program)) {
+		custom_program.code = 0;
+	}
+	// Start it over, it may be a new program
+	custom_state.epoch = 0;
+}
+
+uint8_t Custom_vm() {
+	if (custom_program.code) {
+		return vm_run(&custom_program);
+	}
+	return Chase_vm();
+}
+
+static void clear_page_buf() {
+	uint8_t w;
+	for (w = 0; w < FLASH_PAGE_WORDS; w++) {
+		page_buf[w] = 0xffffffff;
+	}
+}
+
+static void write_page(uint32_t offset) {
+	uint32_t addr = FLASH_ADDR((const uint8_t *)upload_slot + offset);
+	flash_erase_page(addr);
+	flash_write_page(addr, page_buf);
+	clear_page_buf();
+}
+
+int SWIOUploadBegin(uint8_t region, uint32_t length) {
+	if (region != UPLOAD_REGION_VM) {
+		return UPLOAD_ERR_REGION;
+	}
+	if (length < sizeof(struct vm_image) || length > UPLOAD_SLOT_BYTES) {
+		return UPLOAD_ERR_SIZE;
+	}
+	// Don't run the slot while it's being rewritten
+	custom_program.code = 0;
+	upload_length = length;
+	clear_page_buf();
+	flash_unlock();
+	return 0;
+}
+
+int SWIOUploadData(uint32_t offset, const uint8_t * data, int len) {
+	uint8_t * b = (uint8_t *)page_buf;
+	while (len--) {
+		b[offset & (FLASH_PAGE_BYTES - 1)] = *data++;
+		offset++;
+		if ((offset & (FLASH_PAGE_BYTES - 1)) == 0) {
+			write_page(offset - FLASH_PAGE_BYTES);
+		}
+	}
+	return 0;
+}
+
+int SWIOUploadEnd(int ok) {
+	if (ok && (upload_length & (FLASH_PAGE_BYTES - 1))) {
+		write_page(upload_length & ~(FLASH_PAGE_BYTES - 1));
+	}
+	if (!ok) {
+		flash_erase_page(FLASH_ADDR(upload_slot));
+	}
+	flash_lock();
+	upload_init();
+	if (ok && !custom_program.code) {
+		return UPLOAD_ERR_PROGRAM;
+	}
+	return 0;
+}
+
+void handle_debug_input(int numbytes, uint8_t * data) {
+	SWIOUploadHandleInput(numbytes, data);
+}
+
+void upload_poll() {
+	poll_input();
+	SWIOUploadRun();
+}
@@ -0,0 +1,29 @@
+#ifndef _UPLOAD_H
+#define _UPLOAD_H
+
+// Styles sent to a running badge over the debug link, with minichlink -S
+// (make upload), instead of reflashing. They go into a slot in flash, so they
+// survive a power cycle, and play as the Custom_vm style.
+
+#include <stdint.h>
+
+#define UPLOAD_SLOT_BYTES 1024
+
+// Upload regions, the first byte of minichlink -S's start frame
+#define UPLOAD_REGION_VM 0 // A struct vm_image, from tools/vm_compiler -b
+
+// Errors reported back to minichlink, after the ones in swio_upload.h
+#define UPLOAD_ERR_REGION 16
+#define UPLOAD_ERR_SIZE 17
+#define UPLOAD_ERR_PROGRAM 18 // Arrived fine, but vm_check() failed
+
+// Pick up the program in the slot, if there is a good one
+void upload_init();
+
+// Take any upload the host has started. Stays awake until it is done.
+void upload_poll();
+
+// The uploaded style, or Chase_vm() if there isn't one
+uint8_t Custom_vm();
+
+#endif
@@ -0,0 +1,195 @@
+/*
+ * Pattern VM, see vm.h. One switch per instruction, which gcc turns into a
+ * jump table, and a register file small enough to stay out of the way.
+ */
+
+#include "ch32v003fun.h"
+#include "patterns.h"
+#include "vm.h"
+
+// States from an older epoch start over. Never 0, so a zeroed state does too.
+static uint8_t vm_epoch = 1;
+
+static void vm_exec(int32_t * r, const struct vm_insn * pc, const struct vm_insn * end) {
+	int32_t v, acc;
+	uint16_t imm;
+	uint8_t n;
+
+	while (pc < end) {
+		const struct vm_insn in = *pc++;
+		imm = in.b | (in.c << 8);
+		switch (in.op) {
+		case VM_LDI:
+			r[in.a] = (int16_t)imm;
+			break;
+		case VM_LDIH:
+			r[in.a] = (r[in.a] & 0xffff) | ((uint32_t)imm << 16);
+			break;
+		case VM_MOV:
+			r[in.a] = r[in.b];
+			break;
+		case VM_ADD:
+			r[in.a] = r[in.b] + r[in.c];
+			break;
+		case VM_SUB:
+			r[in.a] = r[in.b] - r[in.c];
+			break;
+		case VM_SHL:
+			r[in.a] = (uint32_t)r[in.b] << in.c;
+			break;
+		case VM_SHR:
+			r[in.a] = r[in.b] >> in.c;
+			break;
+		case VM_SCALE:
+			// Shift and add, a multiply would pull in libgcc
+			v = r[in.c];
+			if (v < 0) v = 0;
+			if (v > 256) v = 256;
+			acc = 0;
+			for (n = 0; n < 9; n++) {
+				if (v & (1 << n)) {
+					acc += (uint32_t)r[in.b] << n;
+				}
+			}
+			r[in.a] = acc >> 8;
+			break;
+		case VM_MIN:
+			r[in.a] = (r[in.b] < r[in.c]) ? r[in.b] : r[in.c];
+			break;
+		case VM_MAX:
+			r[in.a] = (r[in.b] > r[in.c]) ? r[in.b] : r[in.c];
+			break;
+		case VM_SAW:
+			r[in.a] = (uint32_t)r[in.b] >> 24;
+			break;
+		case VM_TRI:
+			v = (uint32_t)r[in.b] >> 23;
+			r[in.a] = (v < 256) ? v : 511 - v;
+			break;
+		case VM_CIE:
+			v = r[in.b];
+			if (v < 0) v = 0;
+			if (v > MAX_CIE_INDEX) v = MAX_CIE_INDEX;
+			r[in.a] = CIE[v];
+			break;
+		case VM_OUT:
+			v = r[in.b];
+			if (v < 0) v = 0;
+			if (v > MAX_FINE_PWM_VAL) v = MAX_FINE_PWM_VAL;
+			next_pwm_vals[in.a] = v;
+			break;
+		case VM_BLT:
+			if (r[in.b] < r[in.c]) pc += in.a;
+			break;
+		case VM_BGE:
+			if (r[in.b] >= r[in.c]) pc += in.a;
+			break;
+		case VM_JMP:
+			pc += in.a;
+			break;
+		default:
+			return;
+		}
+	}
+}
+
+// Which of a, b and c are registers, for vm_check()
+#define RA 1
+#define RB 2
+#define RC 4
+static const uint8_t vm_reg_fields[NUM_VM_OPS] = {
+	[VM_LDI] = RA, [VM_LDIH] = RA, [VM_MOV] = RA | RB,
+	[VM_ADD] = RA | RB | RC, [VM_SUB] = RA | RB | RC,
+	[VM_SHL] = RA | RB, [VM_SHR] = RA | RB, [VM_SCALE] = RA | RB | RC,
+	[VM_MIN] = RA | RB | RC, [VM_MAX] = RA | RB | RC,
+	[VM_SAW] = RA | RB, [VM_TRI] = RA | RB, [VM_CIE] = RA | RB,
+	[VM_OUT] = RB, [VM_BLT] = RB | RC, [VM_BGE] = RB | RC,
+};
+
+int vm_check(const struct vm_program * p) {
+	uint16_t n;
+	for (n = 0; n < p->init_length + p->length; n++) {
+		const struct vm_insn in = p->code[n];
+		uint8_t f;
+		if (in.op >= NUM_VM_OPS) {
+			return 0;
+		}
+		f = vm_reg_fields[in.op];
+		if (((f & RA) && in.a >= VM_REGS) || ((f & RB) && in.b >= VM_REGS) || ((f & RC) && in.c >= VM_REGS)) {
+			return 0;
+		}
+		if ((in.op == VM_OUT && in.a >= NUM_LEDS) || ((in.op == VM_SHL || in.op == VM_SHR) && in.c > 31)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static uint8_t leds_dark() {
+	uint8_t l;
+	for (l = 0; l < NUM_LEDS; l++) {
+		if (next_pwm_vals[l] != 0) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+uint8_t vm_run(const struct vm_program * p) {
+	struct vm_state * st = p->state;
+	const struct vm_insn * body = p->code + p->init_length;
+	const struct vm_insn * end = body + p->length;
+	uint16_t shown[NUM_LEDS];
+	uint8_t wakes, l;
+
+	if (st->epoch != vm_epoch) {
+		st->epoch = vm_epoch;
+		st->pending = 0;
+		for (l = 0; l < VM_REGS; l++) {
+			st->regs[l] = 0;
+		}
+		for (l = 0; l < NUM_LEDS; l++) {
+			next_pwm_vals[l] = 0;
+		}
+		vm_exec(st->regs, p->code, body);
+	}
+
+	if (st->pending) {
+		st->pending = 0;
+		for (l = 0; l < NUM_LEDS; l++) {
+			next_pwm_vals[l] = st->pending_vals[l];
+		}
+	} else {
+		vm_exec(st->regs, body, end);
+	}
+
+	// This wake is shown after the sleep, so only a dark one can be slept
+	// through. Run ahead through the dark wakes that follow it. The first lit
+	// one is kept for the next call, so every wake still runs the program once.
+	if (!leds_dark()) {
+		return 1;
+	}
+	for (l = 0; l < NUM_LEDS; l++) {
+		shown[l] = next_pwm_vals[l];
+	}
+	for (wakes = 1; wakes < max_sleep_wakes; wakes++) {
+		vm_exec(st->regs, body, end);
+		if (!leds_dark()) {
+			st->pending = 1;
+			for (l = 0; l < NUM_LEDS; l++) {
+				st->pending_vals[l] = next_pwm_vals[l];
+			}
+			break;
+		}
+	}
+	for (l = 0; l < NUM_LEDS; l++) {
+		next_pwm_vals[l] = shown[l];
+	}
+	return wakes;
+}
+
+void vm_reset() {
+	if (++vm_epoch == 0) {
+		vm_epoch = 1;
+	}
+}
@@ -0,0 +1,94 @@
+#ifndef _VM_H
+#define _VM_H
+
+// A tiny register VM for styles written in the pattern language. Programs are
+// written in vm_styles.pat, compiled by tools/vm_compiler.c into vm_programs.c
+// and live in flash. Each one has a struct vm_state (40 bytes) in RAM and
+// nothing else. Everything is integer, with no heap and no multiplies or
+// divides.
+//
+// Every instruction is 4 bytes: op, a, b, c. Branches only go forward, so a
+// wake runs each instruction at most once: a program costs at most its length
+// in instructions per wake.
+
+#include <stdint.h>
+#include "patterns.h"
+
+#define VM_REGS 8
+
+enum vm_op {
+	VM_END,   // Stop for this wake
+	VM_LDI,   // r[a] = (int16_t)(b | c << 8)
+	VM_LDIH,  // r[a] = (r[a] & 0xffff) | (b | c << 8) << 16
+	VM_MOV,   // r[a] = r[b]
+	VM_ADD,   // r[a] = r[b] + r[c]
+	VM_SUB,   // r[a] = r[b] - r[c]
+	VM_SHL,   // r[a] = r[b] << c
+	VM_SHR,   // r[a] = r[b] >> c, keeping the sign
+	VM_SCALE, // r[a] = r[b] * r[c] / 256, with r[c] clamped to 0..256
+	VM_MIN,   // r[a] = smaller of r[b] and r[c]
+	VM_MAX,   // r[a] = larger of r[b] and r[c]
+	VM_SAW,   // r[a] = top 8 bits of r[b], 0 to 255
+	VM_TRI,   // r[a] = 0 up to 255 and back down over r[b]'s range
+	VM_CIE,   // r[a] = CIE[r[b]], with r[b] clamped to 0..MAX_CIE_INDEX
+	VM_OUT,   // next_pwm_vals[a] = r[b], clamped to 0..MAX_FINE_PWM_VAL
+	VM_BLT,   // If r[b] < r[c], skip the next a instructions
+	VM_BGE,   // If r[b] >= r[c], skip the next a instructions
+	VM_JMP,   // Skip the next a instructions
+	NUM_VM_OPS
+};
+
+struct vm_insn
+{
+	uint8_t op, a, b, c;
+};
+
+struct vm_state
+{
+	int32_t regs[VM_REGS];
+	uint16_t pending_vals[NUM_LEDS]; // A lit wake found while running ahead
+	uint8_t pending;
+	uint8_t epoch;                   // Started since this vm_reset()
+};
+
+struct vm_program
+{
+	const struct vm_insn * code;
+	struct vm_state * state;
+	uint8_t init_length; // code[0] on, run once when the style starts
+	uint8_t length;      // code[init_length] on, run every wake
+};
+
+// A program as a file, for uploading to the badge (tools/vm_compiler -b and
+// upload.c): this header, then init_length + length instructions
+#define VM_IMAGE_MAGIC 0x31504d56 // "VMP1"
+struct vm_image
+{
+	uint32_t magic;
+	uint8_t init_length;
+	uint8_t length;
+	uint16_t reserved;
+};
+
+// Nonzero if every instruction of p is safe to run: known ops, registers and
+// LEDs in range. Programs from vm_programs.c are, uploaded ones get checked.
+int vm_check(const struct vm_program * p);
+
+// Run one wake of a program, as a style. The first call (and the first after
+// vm_reset()) zeroes the registers and runs the init code. Like play_wave(),
+// when this wake is dark it runs ahead to count the dark wakes after it (up to
+// max_sleep_wakes) and returns them as wakes to sleep.
+uint8_t vm_run(const struct vm_program * p);
+
+// Start every program over on its next vm_run()
+void vm_reset();
+
+// Generated into vm_programs.c
+extern const struct vm_program vm_LEDBeats;
+extern const struct vm_program vm_Breathe;
+extern const struct vm_program vm_Chase;
+uint8_t LEDBeats_vm();
+uint8_t Breathe_vm();
+uint8_t Chase_vm();
+
+#endif
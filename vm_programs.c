@@ -0,0 +1,111 @@
+// Generated by tools/vm_compiler.c from vm_styles.pat -- do not edit.
+// Regenerate with: make vm_programs.c
+
+#include "vm.h"
+
+// LEDBeats: 0 init instructions, at most 39 per wake
+static const struct vm_insn LEDBeats_code[39] = {
+	{ VM_SAW,     3,   0,   0 },
+	{ VM_LDI,     6,  64,   0 },
+	{ VM_BGE,     5,   3,   6 },
+	{ VM_SHL,     3,   3,   2 },
+	{ VM_LDI,     7, 255,   0 },
+	{ VM_SUB,     3,   7,   3 },
+	{ VM_CIE,     3,   3,   0 },
+	{ VM_JMP,     1,   0,   0 },
+	{ VM_LDI,     3,   0,   0 },
+	{ VM_OUT,     0,   3,   0 },
+	{ VM_LDI,     7, 164, 218 },
+	{ VM_LDIH,    7, 167,   3 },
+	{ VM_ADD,     0,   0,   7 },
+	{ VM_SAW,     3,   1,   0 },
+	{ VM_LDI,     6,  64,   0 },
+	{ VM_BGE,     5,   3,   6 },
+	{ VM_SHL,     3,   3,   2 },
+	{ VM_LDI,     7, 255,   0 },
+	{ VM_SUB,     3,   7,   3 },
+	{ VM_CIE,     3,   3,   0 },
+	{ VM_JMP,     1,   0,   0 },
+	{ VM_LDI,     3,   0,   0 },
+	{ VM_OUT,     1,   3,   0 },
+	{ VM_LDI,     7, 239,  35 },
+	{ VM_LDIH,    7, 164,   3 },
+	{ VM_ADD,     1,   1,   7 },
+	{ VM_SAW,     3,   2,   0 },
+	{ VM_LDI,     6,  64,   0 },
+	{ VM_BGE,     5,   3,   6 },
+	{ VM_SHL,     3,   3,   2 },
+	{ VM_LDI,     7, 255,   0 },
+	{ VM_SUB,     3,   7,   3 },
+	{ VM_CIE,     3,   3,   0 },
+	{ VM_JMP,     1,   0,   0 },
+	{ VM_LDI,     3,   0,   0 },
+	{ VM_OUT,     2,   3,   0 },
+	{ VM_LDI,     7,  58, 109 },
+	{ VM_LDIH,    7, 160,   3 },
+	{ VM_ADD,     2,   2,   7 },
+};
+
+static struct vm_state LEDBeats_state;
+
+const struct vm_program vm_LEDBeats = { LEDBeats_code, &LEDBeats_state, 0, 39 };
+
+uint8_t LEDBeats_vm() { return vm_run( &vm_LEDBeats ); }
+
+// Breathe: 0 init instructions, at most 19 per wake
+static const struct vm_insn Breathe_code[19] = {
+	{ VM_SAW,     1,   0,   0 },
+	{ VM_LDI,     6,  86,   0 },
+	{ VM_BGE,     5,   1,   6 },
+	{ VM_SHL,     2,   1,   1 },
+	{ VM_ADD,     1,   1,   2 },
+	{ VM_LDI,     6,   1,   0 },
+	{ VM_SUB,     1,   1,   6 },
+	{ VM_JMP,     4,   0,   0 },
+	{ VM_SHL,     2,   1,   1 },
+	{ VM_LDI,     7, 255,   1 },
+	{ VM_SUB,     1,   7,   1 },
+	{ VM_SUB,     1,   1,   2 },
+	{ VM_CIE,     1,   1,   0 },
+	{ VM_OUT,     0,   1,   0 },
+	{ VM_OUT,     1,   1,   0 },
+	{ VM_OUT,     2,   1,   0 },
+	{ VM_LDI,     7,  68, 105 },
+	{ VM_LDIH,    7, 111,   0 },
+	{ VM_ADD,     0,   0,   7 },
+};
+
+static struct vm_state Breathe_state;
+
+const struct vm_program vm_Breathe = { Breathe_code, &Breathe_state, 0, 19 };
+
+uint8_t Breathe_vm() { return vm_run( &vm_Breathe ); }
+
+// Chase: 0 init instructions, at most 18 per wake
+static const struct vm_insn Chase_code[18] = {
+	{ VM_TRI,     2,   0,   0 },
+	{ VM_CIE,     2,   2,   0 },
+	{ VM_OUT,     0,   2,   0 },
+	{ VM_LDI,     6,  85,  85 },
+	{ VM_LDIH,    6,  85,  85 },
+	{ VM_ADD,     1,   0,   6 },
+	{ VM_TRI,     2,   1,   0 },
+	{ VM_CIE,     2,   2,   0 },
+	{ VM_OUT,     1,   2,   0 },
+	{ VM_LDI,     6,  85,  85 },
+	{ VM_LDIH,    6,  85,  85 },
+	{ VM_ADD,     1,   1,   6 },
+	{ VM_TRI,     2,   1,   0 },
+	{ VM_CIE,     2,   2,   0 },
+	{ VM_OUT,     2,   2,   0 },
+	{ VM_LDI,     7, 228,  94 },
+	{ VM_LDIH,    7, 115,   1 },
+	{ VM_ADD,     0,   0,   7 },
+};
+
+static struct vm_state Chase_state;
+
+const struct vm_program vm_Chase = { Chase_code, &Chase_state, 0, 18 };
+
+uint8_t Chase_vm() { return vm_run( &vm_Chase ); }
+